@@ -1,4 +1,4 @@
 #!/bin/bash
 mkdir -p build/
 cd build
-g++ -O2 -o tests ../tests/tests.cpp -lpthread && ./tests
+g++ -std=c++20 -O2 -o tests ../tests/tests.cpp -lpthread && ./tests
@@ -0,0 +1,323 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "eviction_policies.hpp"
+
+/// \brief default_adaptive_samples Default amount of sampled requests between two policy decisions
+static const size_t default_adaptive_samples = 2048;
+
+/// \brief default_shadow_capacity Default capacity the sampled shadow caches aim for
+static const size_t default_shadow_capacity = 512;
+
+/// \brief The eviction_policy_kind enum The policies the adaptive policy chooses from
+enum class eviction_policy_kind : size_t
+{
+    lru = 0,
+    lfu,
+    slru,
+    tinylfu,
+    count
+};
+
+template<class Key, class HashFunction, class KeyEqual>
+/// \brief make_eviction_policy Creates an eviction policy of a given kind
+/// \param kind                 The kind of the policy
+/// \param capacity             The maximum capacity of the cache the policy serves
+/// \return                     The policy
+std::unique_ptr<eviction_policy_t<Key>> make_eviction_policy(eviction_policy_kind kind, size_t capacity)
+{
+    switch (kind) {
+    case eviction_policy_kind::lfu:
+        return std::unique_ptr<eviction_policy_t<Key>>(new lfu_policy_t<Key, HashFunction, KeyEqual>());
+    case eviction_policy_kind::slru:
+        return std::unique_ptr<eviction_policy_t<Key>>(new slru_policy_t<Key, HashFunction, KeyEqual>(capacity));
+    case eviction_policy_kind::tinylfu:
+        return std::unique_ptr<eviction_policy_t<Key>>(new tinylfu_policy_t<Key, HashFunction, KeyEqual>(capacity));
+    default:
+        return std::unique_ptr<eviction_policy_t<Key>>(new lru_policy_t<Key, HashFunction, KeyEqual>());
+    }
+}
+
+/// \brief The shadow_cache_t class Simulates the residency of a small cache of hashed keys under one policy.
+/// Only hits and misses are recorded, no values are stored.
+class shadow_cache_t
+{
+public:
+    /// \brief shadow_cache_t       Constructor
+    /// \param kind                 The simulated policy
+    /// \param capacity             The capacity of the simulated cache
+    shadow_cache_t(eviction_policy_kind kind, size_t capacity)
+        : m_policy(make_eviction_policy<uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>>(kind, capacity)),
+          m_capacity(std::max<size_t>(capacity, 1)),
+          m_hits(0),
+          m_lookups(0)
+    {}
+
+    /// \brief lookup               Simulates a lookup, a miss is followed by an insertion
+    /// \param hash                 The hashed key
+    void lookup(uint64_t hash)
+    {
+        m_lookups++;
+        if (m_resident.count(hash)) {
+            m_hits++;
+            m_policy->on_access(hash);
+            return;
+        }
+        m_policy->on_miss(hash);
+        admit(hash);
+    }
+
+    /// \brief admit                Simulates an insertion without recording a lookup
+    /// \param hash                 The hashed key
+    void admit(uint64_t hash)
+    {
+        if (m_resident.count(hash)) {
+            return;
+        }
+        if (m_resident.size() == m_capacity) {
+            auto victim = m_policy->victim();
+            m_policy->on_erase(victim);
+            m_resident.erase(victim);
+        }
+        m_resident.insert(hash);
+        m_policy->on_insert(hash, 1);
+    }
+
+    /// \brief hit_ratio            The hit ratio since the last reset
+    double hit_ratio() const
+    {
+        return m_lookups ? double(m_hits) / m_lookups : 0.0;
+    }
+
+    /// \brief reset_counters       Restarts the hit ratio measurement
+    void reset_counters()
+    {
+        m_hits = 0;
+        m_lookups = 0;
+    }
+
+    /// \brief policy               The simulated policy
+    eviction_policy_t<uint64_t>& policy()
+    {
+        return *m_policy;
+    }
+
+private:
+    /// \brief m_policy             The simulated policy
+    std::unique_ptr<eviction_policy_t<uint64_t>> m_policy;
+    /// \brief m_resident           The simulated resident set
+    std::unordered_set<uint64_t> m_resident;
+    /// \brief m_capacity           The capacity of the simulated cache
+    size_t m_capacity;
+    /// \brief m_hits               Hits since the last reset
+    size_t m_hits;
+    /// \brief m_lookups            Lookups since the last reset
+    size_t m_lookups;
+};
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The adaptive_eviction_policy_t class Switches the live policy at runtime toward the best performer.
+/// Next to the live policy, small shadow caches of every candidate policy (LRU, LFU, SLRU and W-TinyLFU)
+/// are fed with a hash-sampled subset of the requests (hashed keys only). On the maintenance path, once
+/// enough sampled requests were seen, the live policy is replaced by the candidate whose shadow achieved
+/// the best hit ratio, and the resident keys are handed over to it. While W-TinyLFU is live, its window
+/// size is additionally tuned by hill climbing on the observed hit ratio.
+class adaptive_eviction_policy_t : public eviction_policy_t<Key>
+{
+public:
+    /// \brief adaptive_eviction_policy_t   Constructor
+    /// \param capacity                     The maximum capacity of the cache
+    /// \param samples                      Sampled requests between two policy decisions
+    /// \param initial                      The initially live policy
+    explicit adaptive_eviction_policy_t(
+            size_t capacity,
+            size_t samples = default_adaptive_samples,
+            eviction_policy_kind initial = eviction_policy_kind::lru)
+        : m_capacity(capacity),
+          m_sample_mask(0),
+          m_samples(samples),
+          m_sampled(0),
+          m_live_kind(initial),
+          m_live_tinylfu(nullptr),
+          m_hits(0),
+          m_lookups(0),
+          m_previous_ratio(-1.0),
+          m_window_step(0.05)
+    {
+        size_t shift = 0;
+        while ((capacity >> (shift + 1)) >= default_shadow_capacity && shift < 16) {
+            shift++;
+        }
+        m_sample_mask = (uint64_t(1) << shift) - 1;
+        for (size_t kind = 0; kind < m_shadows.size(); kind++) {
+            m_shadows[kind].reset(new shadow_cache_t(eviction_policy_kind(kind), std::max<size_t>(capacity >> shift, 1)));
+        }
+        switch_to(initial);
+    }
+
+    void on_insert(const Key& key, size_t weight) override
+    {
+        m_live->on_insert(key, weight);
+        auto hash = sample(key);
+        if (sampled(hash)) {
+            for (auto& shadow : m_shadows) {
+                shadow->admit(hash);
+            }
+        }
+    }
+
+    void on_access(const Key& key) override
+    {
+        m_hits++;
+        m_lookups++;
+        m_live->on_access(key);
+        record(key);
+    }
+
+    void on_miss(const Key& key) override
+    {
+        m_lookups++;
+        m_live->on_miss(key);
+        record(key);
+    }
+
+    void on_erase(const Key& key) override { m_live->on_erase(key); }
+    Key victim() override { return m_live->victim(); }
+    std::vector<Key> resident() const override { return m_live->resident(); }
+
+    /// \brief maintenance                  Switches the live policy if a candidate performs clearly better
+    void maintenance() override
+    {
+        m_live->maintenance();
+        if (m_sampled < m_samples) {
+            return;
+        }
+
+        size_t best = static_cast<size_t>(m_live_kind);
+        for (size_t kind = 0; kind < m_shadows.size(); kind++) {
+            if (m_shadows[kind]->hit_ratio() > m_shadows[best]->hit_ratio() + switch_margin) {
+                best = kind;
+            }
+        }
+        if (best != static_cast<size_t>(m_live_kind)) {
+            switch_to(eviction_policy_kind(best));
+        }
+        else if (m_live_tinylfu) {
+            climb_window();
+        }
+
+        for (auto& shadow : m_shadows) {
+            shadow->reset_counters();
+        }
+        m_sampled = 0;
+        m_hits = 0;
+        m_lookups = 0;
+    }
+
+    /// \brief live_policy                  The currently live policy
+    eviction_policy_kind live_policy() const
+    {
+        return m_live_kind;
+    }
+
+private:
+    /// \brief switch_margin                Hit ratio advantage required to switch policies
+    static constexpr double switch_margin = 0.01;
+
+    /// \brief sample                       Hashes a key for the shadow caches
+    uint64_t sample(const Key& key) const
+    {
+        return mix_hash(HashFunction{}(key));
+    }
+
+    /// \brief sampled                      Indicates whether a hashed key is fed to the shadow caches
+    bool sampled(uint64_t hash) const
+    {
+        return (hash & m_sample_mask) == 0;
+    }
+
+    /// \brief record                       Feeds a lookup to the shadow caches if its key is sampled
+    void record(const Key& key)
+    {
+        auto hash = sample(key);
+        if (!sampled(hash)) {
+            return;
+        }
+        m_sampled++;
+        for (auto& shadow : m_shadows) {
+            shadow->lookup(hash);
+        }
+    }
+
+    /// \brief switch_to                    Replaces the live policy, handing the resident keys over
+    void switch_to(eviction_policy_kind kind)
+    {
+        auto next = make_eviction_policy<Key, HashFunction, KeyEqual>(kind, m_capacity);
+        if (m_live) {
+            for (auto& key : m_live->resident()) {
+                next->on_insert(key, 1);
+            }
+        }
+        m_live = std::move(next);
+        m_live_kind = kind;
+        m_live_tinylfu = nullptr;
+        if (kind == eviction_policy_kind::tinylfu) {
+            m_live_tinylfu = static_cast<tinylfu_policy_t<Key, HashFunction, KeyEqual>*>(m_live.get());
+            m_live_tinylfu->set_window(tinylfu_shadow().window());
+        }
+        m_previous_ratio = -1.0;
+    }
+
+    /// \brief climb_window                 One hill climbing step of the W-TinyLFU window size
+    void climb_window()
+    {
+        auto ratio = m_lookups ? double(m_hits) / m_lookups : 0.0;
+        if (m_previous_ratio >= 0.0 && ratio < m_previous_ratio) {
+            m_window_step = -m_window_step;
+        }
+        m_previous_ratio = ratio;
+        auto window = std::min(std::max(m_live_tinylfu->window() + m_window_step, 0.01), 0.8);
+        m_live_tinylfu->set_window(window);
+        tinylfu_shadow().set_window(window);
+    }
+
+    /// \brief tinylfu_shadow               The policy simulated by the W-TinyLFU shadow cache
+    tinylfu_policy_t<uint64_t>& tinylfu_shadow()
+    {
+        return static_cast<tinylfu_policy_t<uint64_t>&>(
+                m_shadows[static_cast<size_t>(eviction_policy_kind::tinylfu)]->policy());
+    }
+
+    /// \brief m_live                       The live policy
+    std::unique_ptr<eviction_policy_t<Key>> m_live;
+    /// \brief m_shadows                    One sampled shadow cache per candidate policy
+    std::array<std::unique_ptr<shadow_cache_t>, static_cast<size_t>(eviction_policy_kind::count)> m_shadows;
+    /// \brief m_capacity                   The maximum capacity of the cache
+    size_t m_capacity;
+    /// \brief m_sample_mask                Keys whose mixed hash has these bits unset are sampled
+    uint64_t m_sample_mask;
+    /// \brief m_samples                    Sampled requests between two policy decisions
+    size_t m_samples;
+    /// \brief m_sampled                    Sampled requests since the last decision
+    size_t m_sampled;
+    /// \brief m_live_kind                  The kind of the live policy
+    eviction_policy_kind m_live_kind;
+    /// \brief m_live_tinylfu               The live policy if it is W-TinyLFU, null otherwise
+    tinylfu_policy_t<Key, HashFunction, KeyEqual>* m_live_tinylfu;
+    /// \brief m_hits                       Live hits since the last decision
+    size_t m_hits;
+    /// \brief m_lookups                    Live lookups since the last decision
+    size_t m_lookups;
+    /// \brief m_previous_ratio             Live hit ratio of the previous hill climbing step
+    double m_previous_ratio;
+    /// \brief m_window_step                Current hill climbing step of the window share
+    double m_window_step;
+};
@@ -0,0 +1,256 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+#include "epoch_pins.hpp"
+
+/// \brief default_slab_size Default size in bytes of the slabs of BytesCache
+static const size_t default_slab_size = 1 << 20;
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The BytesCache class A cache of byte-string Values, e.g. serialized protobuf or JSON messages. Values
+/// are copied once, on insertion, into a byte arena of fixed-size slabs, by bumping the write offset of the
+/// current slab; lookups return std::string_view (or std::span<const std::byte>) views into the arena, so
+/// neither allocates nor copies the Value. At most max_bytes / slab_size slabs hold Values: when the arena is
+/// full, the oldest slab is evicted with all the pairs written into it, so that, as for Cache, the least
+/// recently inserted/updated Keys are evicted first. Updates write the new Value into the current slab.
+///
+/// Views stay valid while the reader holds a pin_t, taken before the lookup. Every pin records the epoch it
+/// was taken in; an evicted slab is retired to a limbo list with the epoch it was evicted in, and only reused
+/// once no pin of that epoch or an older one remains. The slabs never exceed max_bytes: while pins keep an
+/// evicted slab in limbo, insertions that need a new slab are rejected instead. Lookups share a reader-writer
+/// lock, insertions are exclusive.
+class BytesCache
+{
+public:
+    /// \brief pin_t        Guards the views returned by lookups, see epoch_pins_t
+    using pin_t = epoch_pins_t::pin_t;
+
+    /// \brief BytesCache   Constructor, slabs are allocated on demand
+    /// \param max_bytes    The maximum amount of bytes of the slabs holding Values, at least one slab
+    /// \param slab_size    The size of a slab, below 4 GiB; longer Values are never cached
+    explicit BytesCache(size_t max_bytes, size_t slab_size = default_slab_size)
+        : m_slab_size(slab_size ? slab_size : 1),
+          m_max_slabs(std::max<size_t>(max_bytes / m_slab_size, 1))
+    {
+        if (m_slab_size > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("BytesCache supports slabs of less than 4 GiB");
+        }
+    }
+
+    /// \brief Disable copy constructor
+    BytesCache(const BytesCache&) = delete;
+    /// \brief Disable copy assignment operator
+    BytesCache& operator=(const BytesCache&) = delete;
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+    /// \brief capacity     Returns the maximum amount of bytes of the slabs holding Values
+    size_t capacity() const
+    {
+        return m_max_slabs * m_slab_size;
+    }
+
+    /// \brief memory       Returns the amount of bytes of all allocated slabs, including those in limbo
+    size_t memory() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_slabs.size() * m_slab_size;
+    }
+
+    /// \brief pin          Pins the current epoch, so that the views of later lookups stay valid
+    /// \return             The pin, which must not outlive the cache
+    pin_t pin() const
+    {
+        return m_pins.pin();
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists
+    /// \param key          The Key
+    /// \param pin          A pin of this cache, taken before the lookup, that keeps the view valid
+    /// \return             Returns an std::pair<std::string_view, bool>, the view of the Value and whether the
+    ///                     Key was found
+    std::pair<std::string_view, bool> find(const Key& key, const pin_t& pin) const
+    {
+        (void)pin;
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            return std::make_pair(std::string_view(), false);
+        }
+        auto& entry = it->second;
+        return std::make_pair(std::string_view(m_slabs[entry.slab].data.get() + entry.offset, entry.length), true);
+    }
+
+#if defined(__cpp_lib_span)
+    /// \brief find_bytes   Finds the value of corresponding key as a span of bytes, see find
+    std::pair<std::span<const std::byte>, bool> find_bytes(const Key& key, const pin_t& pin) const
+    {
+        auto res = find(key, pin);
+        return std::make_pair(std::as_bytes(std::span<const char>(res.first.data(), res.first.size())),
+                              res.second);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair of bytes, see insert
+    size_t insert(const Key& key, std::span<const std::byte> value)
+    {
+        return insert(key, std::string_view(reinterpret_cast<const char*>(value.data()), value.size()));
+    }
+#endif
+
+    /// \brief insert       Inserts or updates a key-value pair, copying the Value into the arena. If the arena
+    ///                     is full, the oldest slab is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed or the Value could not be stored, 1 if Key is newly added.
+    ///                     A Value longer than a slab, or needing a new slab while pins keep the evicted ones
+    ///                     in limbo (see take_slab), is not stored, and the previous Value of the Key is
+    ///                     removed.
+    size_t insert(const Key& key, std::string_view value)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        if (value.size() > m_slab_size) {
+            // the previous Value stays in its slab, dead, until the slab is evicted
+            m_entries.erase(key);
+            return 0;
+        }
+        if (m_current.empty() || m_slabs[m_current.back()].used + value.size() > m_slab_size) {
+            auto taken = take_slab();
+            if (taken == no_slab) {
+                m_entries.erase(key);
+                return 0;
+            }
+            m_current.push_back(taken);
+        }
+        auto index = m_current.back();
+        auto& slab = m_slabs[index];
+        entry_t entry{index, static_cast<uint32_t>(slab.used), static_cast<uint32_t>(value.size())};
+        std::memcpy(slab.data.get() + slab.used, value.data(), value.size());
+        slab.used += value.size();
+        slab.keys.push_back(key);
+
+        auto res = m_entries.insert(std::make_pair(key, entry));
+        if (!res.second) {
+            // the previous Value stays in its slab, dead, until the slab is evicted
+            res.first->second = entry;
+            return 0;
+        }
+        return 1;
+    }
+
+private:
+    /// \brief The entry_t struct   The location of a Value in the arena
+    struct entry_t
+    {
+        uint32_t slab;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    /// \brief The slab_t struct    A slab of the arena and the Keys whose Values were written into it
+    struct slab_t
+    {
+        std::unique_ptr<char[]> data;
+        /// \brief used             The write offset
+        size_t used;
+        /// \brief keys             The Keys written into the slab, of which those still pointing at it are live
+        std::vector<Key> keys;
+        /// \brief retired_at       The epoch the slab was evicted in, while in limbo
+        uint64_t retired_at;
+    };
+
+    /// \brief no_slab              Marks failed slab allocations
+    static constexpr uint32_t no_slab = std::numeric_limits<uint32_t>::max();
+
+    /// \brief take_slab            Returns an empty slab: a reclaimed or new one, or else one freed by evicting
+    ///                             the oldest slab. Returns no_slab if there is none, i.e. while pins keep the
+    ///                             evicted slabs in limbo.
+    uint32_t take_slab()
+    {
+        reclaim();
+        if (m_free.empty() && m_slabs.size() >= m_max_slabs && m_limbo.empty() && !m_current.empty()) {
+            // while pins keep evicted slabs in limbo, evicting more slabs would not free one either
+            retire(m_current.front());
+            m_current.pop_front();
+            reclaim();
+        }
+        if (m_free.empty()) {
+            if (m_slabs.size() >= m_max_slabs) {
+                return no_slab;
+            }
+            m_slabs.push_back(slab_t{std::unique_ptr<char[]>(new char[m_slab_size]), 0, {}, 0});
+            return static_cast<uint32_t>(m_slabs.size() - 1);
+        }
+        auto index = m_free.back();
+        m_free.pop_back();
+        return index;
+    }
+
+    /// \brief retire               Evicts the pairs whose Values are in a slab and moves it to the limbo list
+    void retire(uint32_t index)
+    {
+        auto& slab = m_slabs[index];
+        for (auto& key : slab.keys) {
+            auto it = m_entries.find(key);
+            if (it != m_entries.end() && it->second.slab == index) {
+                m_entries.erase(it);
+            }
+        }
+        slab.keys.clear();
+        slab.retired_at = m_pins.retire();
+        m_limbo.push_back(index);
+    }
+
+    /// \brief reclaim              Frees the slabs in limbo that no pin can still view
+    void reclaim()
+    {
+        auto oldest = m_pins.oldest();
+        while (!m_limbo.empty() && m_slabs[m_limbo.front()].retired_at < oldest) {
+            m_slabs[m_limbo.front()].used = 0;
+            m_free.push_back(m_limbo.front());
+            m_limbo.pop_front();
+        }
+    }
+
+    /// \brief m_slab_size          The size of a slab
+    const size_t m_slab_size;
+    /// \brief m_max_slabs          The maximum amount of slabs holding Values
+    const size_t m_max_slabs;
+    /// \brief m_entries            The location of the Value of every Key
+    std::unordered_map<Key, entry_t, HashFunction, KeyEqual> m_entries;
+    /// \brief m_slabs              All allocated slabs
+    std::vector<slab_t> m_slabs;
+    /// \brief m_current            The slabs holding Values, oldest first, the last one being written
+    std::deque<uint32_t> m_current;
+    /// \brief m_limbo              The evicted slabs that pins may still view, oldest first
+    std::deque<uint32_t> m_limbo;
+    /// \brief m_free               The empty slabs
+    std::vector<uint32_t> m_free;
+    /// \brief m_mutex              Guards the pairs and the slabs, shared by lookups
+    mutable std::shared_mutex m_mutex;
+    /// \brief m_pins               The pins of the readers, see epoch_pins_t
+    epoch_pins_t m_pins;
+};
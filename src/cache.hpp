@@ -1,8 +1,31 @@
+#pragma once
 #include <iostream>
 #include <unordered_map>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <future>
+#include <random>
+#include <cmath>
+#include <tuple>
+#include <type_traits>
+#include <stdexcept>
 #include "thread_safety.hpp"
+#include "eviction_policy.hpp"
+#include "timing_wheel.hpp"
+#include "coarse_clock.hpp"
+#include "thread_pool.hpp"
+#include "hashing.hpp"
+#include "key_codec.hpp"
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+#if __cplusplus >= 202002L
+#include <span>
+#endif
 
 /// \brief default_max_size Default maximum capacity of cache
 static const size_t default_max_size = 100;
@@ -10,13 +33,49 @@ static const size_t default_max_size = 100;
 /// \brief default_log_level Default log options
 static const bool default_log_level = false;
 
-/// \brief The cache_key_hash_function struct Hash function for default cache Key type
+/// \brief default_max_weight Default maximum total weight of cache (unbounded)
+static const size_t default_max_weight = std::numeric_limits<size_t>::max();
+
+/// \brief default_maintenance_interval Default amount of insertions between two maintenance runs
+static const size_t default_maintenance_interval = 1024;
+
+/// \brief default_loader_threads Default amount of threads running background loads and refreshes
+static const size_t default_loader_threads = 4;
+
+/// \brief The cache_key_hash_function struct Hash function for default cache Key types (pairs and tuples).
+/// The hashes of the members are combined in order with hash_combine, so that swapped members and equal
+/// members do not collide.
 struct cache_key_hash_function
 {
     template <class T1, class T2>
     std::size_t operator() (const std::pair<T1,T2>& t) const
     {
-        return std::hash<T1>{}(t.first) ^ std::hash<T2>{}(t.second);
+        return hash_combine(hash_combine(0, std::hash<T1>{}(t.first)), std::hash<T2>{}(t.second));
+    }
+
+    template <class... T>
+    std::size_t operator() (const std::tuple<T...>& t) const
+    {
+        return combine(t, std::index_sequence_for<T...>{});
+    }
+
+private:
+    template <class Tuple, std::size_t... I>
+    static std::size_t combine(const Tuple& t, std::index_sequence<I...>)
+    {
+        uint64_t seed = 0;
+        ((seed = hash_combine(seed, std::hash<typename std::tuple_element<I, Tuple>::type>{}(std::get<I>(t)))), ...);
+        return seed;
+    }
+};
+
+/// \brief The unit_weigher struct Default weigher of the cache, every entry weighs 1
+struct unit_weigher
+{
+    template <class K, class V>
+    size_t operator() (const K&, const V&) const
+    {
+        return 1;
     }
 };
 
@@ -25,21 +84,45 @@ template<
     class Value,
     class HashFunction=std::hash<Key>,
     class KeyEqual=std::equal_to<Key>,
-    class Allocator=std::allocator<std::pair<const Key, Value>>
+    class Allocator=std::allocator<std::pair<const Key, Value>>,
+    class Weigher=unit_weigher,
+    class KeyCodec=identity_key_codec<Key>
 >
 /// \brief The Cache class This templated class consists a Cache that functions at an LRU manner.
 /// The insertion and look up complexity is O(1).
-/// An insertion implies the insertion to three data structures:
-/// 1. hashmap from Keys to Values
-/// 2. hashmap from Keys to insertion rounds
-/// 3. hashmap from insertion round to Keys.
+/// An insertion implies the insertion to two data structures:
+/// 1. hashmap from Keys to Values and insertion rounds
+/// 2. hashmap from insertion round to Keys.
+/// Keys are hashed once per operation; the hash value is stored with them and reused by both hashmaps.
+/// Keys are stored in the form of the KeyCodec (e.g. packed into an integer, see key_codec.hpp): the
+/// HashFunction, KeyEqual, Weigher and eviction policy apply to encoded Keys, which are decoded for the loader
+/// and for printing. With an interning KeyCodec, every stored Key holds a reference to its interned form.
 /// Key features:
 /// 1. Keys and Values can be of arbitrary type.
-/// 2. User can provide a maximum capacity.
+/// 2. User can provide a maximum capacity, in entries and/or in total weight (see Weigher).
 /// 3. Multithreaded functionality is provided.
+/// 4. The eviction decision can be delegated to a pluggable eviction_policy_t.
+/// 5. Pairs can be given a time-to-live and/or a cache-wide time-to-idle, tracked by a hierarchical timing wheel.
+/// 6. Pairs older than a threshold can be reloaded in the background (refresh-ahead) through a loader.
+/// 7. Expiring pairs can be recomputed early by a single caller (probabilistic early recomputation).
+/// 8. Missing pairs can be loaded synchronously, asynchronously or by awaiting them in a coroutine, with
+///    concurrent misses deduplicated.
 class Cache
 {
 public:
+    /// \brief clock_type   The clock expiration times are measured with. It is a cached, coarse clock, so
+    ///                     that lookups never read the system clock.
+    using clock_type = coarse_clock_t;
+
+    /// \brief stored_type  The encoded form of the Keys, which the cache stores, hashes and compares
+    using stored_type = typename KeyCodec::encoded_type;
+
+    /// \brief hashed_type  An encoded Key with its hash value, see hash_key
+    using hashed_type = hashed_key_t<stored_type>;
+
+    /// \brief loader_type  Computes the Value of a Key, e.g. by querying a backend
+    using loader_type = std::function<Value(const Key&)>;
+
     /// \brief Cache        Constructor of the LRU cache
     /// \param max_size     The maximum capacity of the cache
     /// \param enable_logs  Enables/disables verbosity
@@ -47,7 +130,16 @@ public:
         : m_round_counter(0),
           m_max_size(max_size),
           m_oldest_insertion(1),
-          m_enable_logs(enable_logs)
+          m_enable_logs(enable_logs),
+          m_max_weight(default_max_weight),
+          m_total_weight(0),
+          m_time_to_idle(std::chrono::nanoseconds::zero()),
+          m_refresh_after(std::chrono::nanoseconds::zero()),
+          m_loader_threads(default_loader_threads),
+          m_early_recomputation(0),
+          m_random(std::random_device{}()),
+          m_wheel(),
+          m_operations(0)
           // m_writers_counter(0),
           // m_readers_counter(0)
     {}
@@ -57,23 +149,55 @@ public:
     /// \brief Disable copy assignment operator
     Cache& operator=(const Cache&) = delete;
 
-    /// \brief Move constructor
+    /// \brief Move constructor. A cache must not be moved while loads or refreshes are in flight.
     Cache(Cache&& other)
         : Cache()
     {
         swap(*this, other);
     }
 
+    /// \brief Destructor, waits for the loads and refreshes in flight
+    ~Cache()
+    {
+        // draining a pool can resume coroutines that use a new one
+        while (true) {
+            std::unique_ptr<thread_pool_t> pool;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                pool.swap(m_pool);
+            }
+            if (!pool) {
+                break;
+            }
+        }
+        for (auto& c : m_cache) {
+            release_key(c.first.key);
+        }
+    }
+
     friend void swap(Cache& first, Cache& second)
     {
         using std::swap;
         swap(first.m_cache, second.m_cache);
-        swap(first.m_rounds, second.m_rounds);
         swap(first.m_reverse_rounds, second.m_reverse_rounds);
         swap(first.m_round_counter, second.m_round_counter);
         swap(first.m_oldest_insertion, second.m_oldest_insertion);
         swap(first.m_max_size, second.m_max_size);
         swap(first.m_enable_logs, second.m_enable_logs);
+        swap(first.m_policy, second.m_policy);
+        swap(first.m_weigher, second.m_weigher);
+        swap(first.m_max_weight, second.m_max_weight);
+        swap(first.m_total_weight, second.m_total_weight);
+        swap(first.m_time_to_idle, second.m_time_to_idle);
+        swap(first.m_wheel, second.m_wheel);
+        swap(first.m_loader, second.m_loader);
+        swap(first.m_refresh_after, second.m_refresh_after);
+        swap(first.m_loader_threads, second.m_loader_threads);
+        swap(first.m_pool, second.m_pool);
+        swap(first.m_loads, second.m_loads);
+        swap(first.m_early_recomputation, second.m_early_recomputation);
+        swap(first.m_random, second.m_random);
+        swap(first.m_operations, second.m_operations);
     }
 
     /// \brief size Returns the amount of inserted key-value pairs
@@ -83,6 +207,26 @@ public:
         return m_cache.size();
     }
 
+    /// \brief weight   Returns the total weight of the inserted key-value pairs
+    /// \return         The total weight, as measured by the Weigher
+    size_t weight()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_total_weight;
+    }
+
+    /// \brief set_max_weight   Bounds the total weight of the cache. Least recent pairs are evicted until
+    ///                         the inserted pairs fit.
+    /// \param max_weight       The maximum total weight, as measured by the Weigher
+    void set_max_weight(size_t max_weight)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_max_weight = max_weight;
+        while (!m_cache.empty() && m_total_weight > m_max_weight) {
+            delete_victim();
+        }
+    }
+
     /// \brief find         Finds the value of corresponding key, if exists.
     /// \param key          The Key
     /// \param sleeptime    Optiion to cause delays (for testing multithreading functionalities)
@@ -95,53 +239,413 @@ public:
     std::pair<Value, bool> find(const Key& key, int sleeptime = 0)
     {
         std::lock_guard<std::mutex> lock(m_mutex);
+        // encoded with the mutex held, so that the ids of interned components are not reused meanwhile
+        decltype(auto) encoded = KeyCodec::encode(key);
         if (sleeptime) {
             std::this_thread::sleep_for(std::chrono::seconds(sleeptime));
         }
-        auto item = m_cache.find(key);
-        if (item == m_cache.end()) {
-            return std::make_pair(Value{}, false);
+        return find_record(hash_key(encoded));
+    }
+
+    /// \brief find         Finds the value of a Key hashed with hash_key, see find
+    std::pair<Value, bool> find(const hashed_type& key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return find_record(key);
+    }
+
+    /// \brief hash_key     Hashes an encoded Key with the HashFunction, so that callers which already need the
+    ///                     hash value (e.g. to select a shard) can reuse it for the cache's own lookups
+    /// \param key          The encoded Key, which must outlive the returned probe
+    /// \return             A probe referring to the encoded Key
+    static hashed_type hash_key(const stored_type& key)
+    {
+        return hashed_type::probe(key, HashFunction{}(key));
+    }
+
+    /// \brief get_or_load  Finds the value of a Key, loading and inserting it on a miss. Concurrent misses
+    ///                     of the same Key are deduplicated: exactly one caller runs the loader while the
+    ///                     others wait for its result. If the loader throws, every waiting caller gets the
+    ///                     exception and nothing is inserted, so the next call loads again.
+    /// \param key          The Key
+    /// \param loader       Computes the Value of the Key, called without holding the cache's mutex
+    /// \return             The cached or loaded Value
+    Value get_or_load(const Key& key, const loader_type& loader)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // encoded with the mutex held, so that it matches the Keys interned by the loads in flight
+        decltype(auto) encoded = KeyCodec::encode(key);
+        auto found = find_record(hash_key(encoded));
+        if (found.second) {
+            return found.first;
+        }
+
+        // join the load in flight, if any
+        auto load = m_loads.find(encoded);
+        if (load != m_loads.end()) {
+            auto result = load->second.result;
+            lock.unlock();
+            return result.get();
+        }
+
+        std::promise<Value> promise;
+        auto registered = register_load(key, promise.get_future().share());
+        auto result = registered.first.result;
+        lock.unlock();
+
+        if (registered.second) {
+            run_load(key, loader, promise);
+        }
+        return result.get();
+    }
+
+    /// \brief get_async    Finds the value of a Key, loading it in the background on a miss through the
+    ///                     loader registered via set_loader. Loads run on a pool of set_loader_threads
+    ///                     threads owned by the cache, and their results are inserted on completion.
+    ///                     Concurrent misses of the same Key, including those of get_or_load, share one load.
+    /// \param key          The Key
+    /// \return             A future of the Value, ready immediately on a hit. A failed load, or a missing
+    ///                     loader, stores the exception in the future and caches nothing.
+    std::shared_future<Value> get_async(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        decltype(auto) encoded = KeyCodec::encode(key);
+        auto found = find_record(hash_key(encoded));
+        if (found.second) {
+            std::promise<Value> promise;
+            promise.set_value(std::move(found.first));
+            return promise.get_future().share();
+        }
+
+        return start_load(key, encoded).result;
+    }
+
+#if defined(__cpp_impl_coroutine)
+    /// \brief executor_type Runs a task, e.g. by queueing it on an event loop
+    using executor_type = std::function<void(std::function<void()>)>;
+
+    /// \brief The get_awaitable_t class Awaitable lookup returned by get. A hit completes without suspending
+    /// or allocating: the awaitable refers to the Key, which outlives the co_await expression, and only takes
+    /// the executor over on a miss. A miss suspends the coroutine and joins or starts the load of the Key, like
+    /// get_async, and the coroutine is resumed on the executor once the load completes.
+    class get_awaitable_t
+    {
+    public:
+        get_awaitable_t(Cache& cache, const Key& key, executor_type executor)
+            : m_cache(cache), m_key(key), m_executor(std::move(executor))
+        {}
+
+        bool await_ready()
+        {
+            std::lock_guard<std::mutex> lock(m_cache.m_mutex);
+            decltype(auto) encoded = KeyCodec::encode(m_key);
+            m_found = m_cache.find_record(Cache::hash_key(encoded));
+            return m_found.second;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine)
+        {
+            std::lock_guard<std::mutex> lock(m_cache.m_mutex);
+            decltype(auto) encoded = KeyCodec::encode(m_key);
+            // the Key may have been loaded since await_ready
+            m_found = m_cache.find_record(Cache::hash_key(encoded));
+            if (m_found.second) {
+                return false;
+            }
+            auto& load = m_cache.start_load(m_key, encoded);
+            m_result = load.result;
+            auto& cache = m_cache;
+            load.waiters.push_back([&cache, executor = std::move(m_executor), coroutine]() {
+                if (executor) {
+                    executor([coroutine]() { coroutine.resume(); });
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(cache.m_mutex);
+                cache.pool().submit([coroutine]() { coroutine.resume(); });
+            });
+            return true;
+        }
+
+        Value await_resume()
+        {
+            return m_found.second ? std::move(m_found.first) : m_result.get();
         }
-        auto previously_inserted_round = inserted_round(key);
 
-        return std::make_pair(item->second, true);
+    private:
+        /// \brief m_cache      The cache looked up
+        Cache& m_cache;
+        /// \brief m_key        The Key looked up, an argument of the co_await expression
+        const Key& m_key;
+        /// \brief m_executor   Resumes the coroutine after a miss, the loader threads if empty
+        executor_type m_executor;
+        /// \brief m_found      The Value found without loading it
+        std::pair<Value, bool> m_found;
+        /// \brief m_result     The result of the load after a miss
+        std::shared_future<Value> m_result;
+    };
+
+    /// \brief get          Awaitable lookup, co_await cache.get(key) yields the Value of the Key, loaded through
+    ///                     the loader registered via set_loader on a miss. A failed load rethrows in the
+    ///                     coroutine. The cache must outlive the suspended coroutines.
+    /// \param key          The Key
+    /// \param executor     Resumes the coroutine after a miss, on the loader threads by default
+    get_awaitable_t get(const Key& key, executor_type executor = executor_type())
+    {
+        return get_awaitable_t(*this, key, std::move(executor));
     }
+#endif
 
-    /// \brief insert       Inserts a key-value pair in the cache. If max capacity is reached, the oldest
-    ///                     key-value pair is evicted.
+    /// \brief insert       Inserts a key-value pair in the cache. If max capacity or max weight is reached,
+    ///                     the oldest key-value pairs are evicted until the new pair fits.
+    ///                     A pair heavier than the max weight is rejected.
     /// \param key          The Key
     /// \param value        The Value
     /// \param sleeptime    Optiion to cause delays (for testing multithreading functionalities)
-    /// \return             0 if  Key already existed, 1 if  Key is newly added
+    /// \return             0 if  Key already existed or the pair was rejected, 1 if  Key is newly added
     size_t insert(Key key, Value value, int sleeptime = 0)
     {
+        decltype(auto) encoded = intern_key(key);
         std::lock_guard<std::mutex> lock(m_mutex);
 
         if (sleeptime > 0) {
             std::this_thread::sleep_for(std::chrono::seconds(sleeptime));
         }
 
-        auto previously_inserted_round = inserted_round(key);
+        auto inserted = insert_record(hash_key(encoded), value, clock_type::time_point::max());
+        release_key(encoded);
+        return inserted;
+    }
 
-        // in case of new insertion
-        if (previously_inserted_round == 0) {
-            // increment rounds
-            m_round_counter++;
+    /// \brief insert       Inserts a pair whose Key was hashed with hash_key, see insert. With an interning
+    ///                     KeyCodec, the encoded Key must be held by the caller, e.g. from KeyCodec::intern.
+    size_t insert(const hashed_type& key, Value value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return insert_record(key, value, clock_type::time_point::max());
+    }
+
+    /// \brief insert       Inserts a key-value pair that expires after a time-to-live. Expired pairs are
+    ///                     reported as missing and reclaimed lazily on access or by the maintenance.
+    ///                     Re-inserting an existing, unexpired Key keeps its value and expiration time,
+    ///                     unless the Key was reported as an early miss, see set_early_recomputation.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \param time_to_live The time after which the pair expires
+    /// \param recompute_time The time it took to compute the value, if known. Later recomputations
+    ///                     following an early miss are measured by the cache.
+    /// \return             0 if  Key already existed or the pair was rejected, 1 if  Key is newly added
+    size_t insert(Key key, Value value, std::chrono::nanoseconds time_to_live,
+                  std::chrono::nanoseconds recompute_time = std::chrono::nanoseconds::zero())
+    {
+        decltype(auto) encoded = intern_key(key);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto hashed = hash_key(encoded);
+        auto inserted = insert_record(hashed, value, clock_type::now() + time_to_live, recompute_time);
+        release_key(encoded);
+        return inserted;
+    }
 
-            // in case of max capacity
-            if (m_cache.size() == m_max_size) {
-                delete_least_recent();
+    /// \brief multi_find   Finds the values of a batch of keys, locking the cache once for the whole batch.
+    ///                     Keys are looked up in groups whose memory accesses are overlapped: the bucket
+    ///                     heads of a whole group are read and the first node of every bucket prefetched
+    ///                     before any key is compared.
+    /// \param keys         The keys
+    /// \param count        The amount of keys, or of indices if given
+    /// \param values       Receives the Value of the i-th key at index i, untouched for missing keys
+    /// \param found        Bitmap of (keys + 63) / 64 words, bit i is set iff the i-th key was found
+    /// \param indices      If given, only the keys at these indices are looked up
+    /// \param hashes       If given, the hash value of the encoded i-th key at index i (see hash_key)
+    void multi_find(const Key* keys, size_t count, Value* values, uint64_t* found,
+                    const size_t* indices = nullptr, const uint64_t* hashes = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        hashed_type group[prefetch_group];
+        scratch_type scratch[prefetch_group];
+        for (size_t j = 0; j < count; j++) {
+            if (j % prefetch_group == 0) {
+                auto group_size = std::min(prefetch_group, count - j);
+                hash_group(keys, j, group_size, indices, hashes, scratch, group);
+                prefetch_nodes(group, group_size);
+            }
+            auto i = indices ? indices[j] : j;
+            auto result = find_record(group[j % prefetch_group]);
+            if (result.second) {
+                values[i] = std::move(result.first);
+                found[i / 64] |= uint64_t(1) << (i % 64);
             }
+            else {
+                found[i / 64] &= ~(uint64_t(1) << (i % 64));
+            }
+        }
+    }
 
-            insert_new_record(key, value);
-            return 1;
+    /// \brief multi_insert Inserts a batch of key-value pairs, locking the cache once for the whole batch.
+    ///                     HashFunctions with a hash_batch (see has_hash_batch) hash the keys in groups.
+    /// \param keys         The keys
+    /// \param values       The value of the i-th key at index i
+    /// \param count        The amount of pairs, or of indices if given
+    /// \param indices      If given, only the pairs at these indices are inserted
+    /// \param hashes       If given, the hash value of the encoded i-th key at index i (see hash_key)
+    /// \return             The amount of newly added keys
+    size_t multi_insert(const Key* keys, const Value* values, size_t count, const size_t* indices = nullptr,
+                        const uint64_t* hashes = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t inserted = 0;
+        if constexpr (batch_hashing) {
+            if (!hashes) {
+                stored_type encoded[prefetch_group];
+                uint64_t group_hashes[prefetch_group];
+                for (size_t j = 0; j < count; j += prefetch_group) {
+                    auto group_size = std::min(prefetch_group, count - j);
+                    for (size_t k = 0; k < group_size; k++) {
+                        encoded[k] = intern_key(keys[indices ? indices[j + k] : j + k]);
+                    }
+                    HashFunction::hash_batch(encoded, group_size, group_hashes);
+                    for (size_t k = 0; k < group_size; k++) {
+                        auto i = indices ? indices[j + k] : j + k;
+                        auto value = values[i];
+                        inserted += insert_record(hashed_type::probe(encoded[k], group_hashes[k]), value,
+                                                  clock_type::time_point::max());
+                        release_key(encoded[k]);
+                    }
+                }
+                return inserted;
+            }
+        }
+        for (size_t j = 0; j < count; j++) {
+            auto i = indices ? indices[j] : j;
+            auto value = values[i];
+            decltype(auto) encoded = intern_key(keys[i]);
+            auto key = hashes ? hashed_type::probe(encoded, hashes[i]) : hash_key(encoded);
+            inserted += insert_record(key, value, clock_type::time_point::max());
+            release_key(encoded);
         }
+        return inserted;
+    }
 
-        // in case of already inserted item
-        if (previously_inserted_round != m_round_counter) {
-            update_inserted_round(key, previously_inserted_round);
+#if defined(__cpp_lib_span)
+    /// \brief multi_find   See multi_find, found holds at least (keys.size() + 63) / 64 words. Throws
+    ///                     std::length_error if values or found are too short.
+    void multi_find(std::span<const Key> keys, std::span<Value> values, std::span<uint64_t> found)
+    {
+        if (values.size() < keys.size() || found.size() < (keys.size() + 63) / 64) {
+            throw std::length_error("multi_find output spans are shorter than the keys");
+        }
+        multi_find(keys.data(), keys.size(), values.data(), found.data());
+    }
+
+    /// \brief multi_insert See multi_insert, throws std::length_error if values is shorter than keys
+    size_t multi_insert(std::span<const Key> keys, std::span<const Value> values)
+    {
+        if (values.size() < keys.size()) {
+            throw std::length_error("multi_insert values span is shorter than the keys");
+        }
+        return multi_insert(keys.data(), values.data(), keys.size());
+    }
+#endif
+
+    /// \brief set_time_to_idle     Makes pairs expire once they have not been read for a given time.
+    ///                             Reads and re-insertions of a Key reset its idle time. The idle time of
+    ///                             the pairs already inserted starts now.
+    /// \param time_to_idle         The maximum idle time, zero disables idle expiration
+    void set_time_to_idle(std::chrono::nanoseconds time_to_idle)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_time_to_idle = time_to_idle;
+        auto now = clock_type::now();
+        for (auto& c : m_cache) {
+            c.second.last_access = now;
+            schedule_expiry(c.first, c.second);
+        }
+    }
+
+    /// \brief set_loader           Registers the loader used to reload pairs in the background
+    /// \param loader               The loader, called without holding the cache's mutex
+    void set_loader(loader_type loader)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loader = std::move(loader);
+    }
+
+    /// \brief set_loader_threads   Sets the amount of threads running background loads and refreshes,
+    ///                             which bounds their concurrency. Loads already queued complete first.
+    /// \param threads              The amount of threads, at least one
+    void set_loader_threads(size_t threads)
+    {
+        // the previous pool drains once the mutex is released, its tasks lock it
+        std::unique_ptr<thread_pool_t> pool;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loader_threads = threads;
+        pool.swap(m_pool);
+    }
+
+    /// \brief set_refresh_after    Enables refresh-ahead. A read of a pair written longer than the given time
+    ///                             ago returns the current value immediately and triggers a single
+    ///                             background reload through the loader. The reloaded value replaces the
+    ///                             current one and restarts its time-to-live. A failed reload keeps the
+    ///                             current value.
+    /// \param refresh_after        The age after which pairs are refreshed, zero disables refresh-ahead
+    void set_refresh_after(std::chrono::nanoseconds refresh_after)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_refresh_after = refresh_after;
+        if (refresh_after != std::chrono::nanoseconds::zero()) {
+            // the age of the pairs inserted without reading the clock starts now
+            auto now = clock_type::now();
+            for (auto& c : m_cache) {
+                if (c.second.written_at == clock_type::time_point()) {
+                    c.second.written_at = now;
+                }
+            }
+        }
+    }
+
+    /// \brief set_early_recomputation Enables probabilistic early recomputation (XFetch). A read of a pair
+    ///                             with a time-to-live is reported as a miss ahead of its expiration with a
+    ///                             probability growing as the expiration approaches, scaled by the time it
+    ///                             takes to recompute the pair. Only one caller gets the early miss; the
+    ///                             others keep reading the current value until that caller re-inserts the
+    ///                             Key, which replaces the value and expiration time.
+    /// \param beta                 How eagerly pairs are recomputed, 1 is the usual choice, 0 disables
+    void set_early_recomputation(double beta)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_early_recomputation = beta;
+    }
+
+    /// \brief set_eviction_policy  Delegates eviction decisions to a policy. The policy is informed
+    ///                             about all currently resident keys, oldest first, in their encoded form.
+    ///                             Passing a null pointer restores the built-in LRU eviction.
+    /// \param policy               The eviction policy
+    void set_eviction_policy(std::unique_ptr<eviction_policy_t<stored_type>> policy)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_policy = std::move(policy);
+        if (!m_policy) {
+            return;
+        }
+        std::vector<std::pair<size_t, const stored_type*>> resident;
+        resident.reserve(m_cache.size());
+        for (auto& c : m_cache) {
+            resident.emplace_back(c.second.round, &c.first.key);
+        }
+        std::sort(resident.begin(), resident.end(),
+                [](const std::pair<size_t, const stored_type*>& a, const std::pair<size_t, const stored_type*>& b) {
+                    return a.first < b.first;
+                });
+        for (auto& r : resident) {
+            m_policy->on_insert(*r.second, m_cache.find(hash_key(*r.second))->second.weight);
         }
-        return 0;
+    }
+
+    /// \brief run_maintenance      Runs the periodic housekeeping (reclaiming expired pairs, policy training)
+    ///                             immediately.
+    ///                             It also runs automatically every default_maintenance_interval insertions.
+    void run_maintenance()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        maintenance();
     }
 
     /// \brief print    Prints the contents of the cache (for debbugging purposes)
@@ -154,36 +658,546 @@ public:
     {
         for (auto& c : m_cache) {
             std::cout << "[";
-            print_key(c.first);
+            print_key(KeyCodec::decode(c.first.key));
             std::cout << "] -> ";
-            print_value(c.second);
-            std::cout << " (at round " << m_rounds[c.first] << ")" << std::endl;
+            print_value(c.second.value);
+            std::cout << " (at round " << c.second.round << ")" << std::endl;
         }
         std::cout << "Contents of cache (" << m_cache.size() << "):" << std::endl;
     }
 
 private:
-    /// \brief inserted_round   Return the round a  Key was inserted
-    /// \param key              The key
-    /// \return                 The round if the  Key exists, 0 otherwise
-    size_t inserted_round(const Key& key) const
+    /// \brief The entry_t struct           A cached value and its metadata
+    struct entry_t
+    {
+        /// \brief value                    The cached value
+        Value value;
+        /// \brief weight                   The weight of the pair, as measured by the Weigher
+        size_t weight;
+        /// \brief round                    The round the pair was inserted or last updated
+        size_t round;
+        /// \brief expires_at               The expiration time, time_point::max() if the pair never expires
+        clock_type::time_point expires_at;
+        /// \brief last_access              The time of the last read or insertion, if idle expiration is on
+        clock_type::time_point last_access;
+        /// \brief written_at               The time the value was inserted or last refreshed
+        clock_type::time_point written_at;
+        /// \brief refreshing               Whether a background reload of the value is in flight
+        bool refreshing;
+        /// \brief recompute_time           The time it took to compute the value, zero if unknown
+        std::chrono::nanoseconds recompute_time;
+        /// \brief recompute_started        The time of the early miss, time_point() if none is pending
+        clock_type::time_point recompute_started;
+    };
+
+    /// \brief The load_t struct    A load in flight
+    struct load_t
+    {
+        /// \brief result           The loaded Value, or the exception of the loader
+        std::shared_future<Value> result;
+        /// \brief waiters          Called once the load completes, e.g. to resume awaiting coroutines
+        std::vector<std::function<void()>> waiters;
+    };
+
+    using entry_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const hashed_type, entry_t>>;
+    using map_type = std::unordered_map<hashed_type, entry_t, stored_hash, hashed_key_equal<KeyEqual>, entry_allocator_t>;
+
+    /// \brief prefetch_group       The amount of keys of multi_find whose lookups are overlapped
+    static constexpr size_t prefetch_group = 16;
+
+    /// \brief encodes_in_place     Whether the KeyCodec returns a reference to the Key, i.e. stores it as it is
+    static constexpr bool encodes_in_place =
+            std::is_reference<decltype(KeyCodec::encode(std::declval<const Key&>()))>::value;
+
+    /// \brief batch_hashing        Whether the HashFunction hashes batches of encoded Keys, see has_hash_batch
+    static constexpr bool batch_hashing = has_hash_batch<HashFunction, stored_type>::value;
+
+    /// \brief scratch_type         Holds an encoded Key for the batch operations, unused if encodes_in_place
+    ///                             and the keys are hashed one at a time
+    using scratch_type = typename std::conditional<encodes_in_place && !batch_hashing, bool, stored_type>::type;
+
+    /// \brief key_interning        Whether the KeyCodec interns Keys, see has_key_interning
+    static constexpr bool key_interning = has_key_interning<KeyCodec>::value;
+
+    /// \brief intern_key           The encoded form of a Key to be stored, holding a reference if the codec
+    ///                             interns Keys, see release_key
+    static decltype(auto) intern_key(const Key& key)
+    {
+        if constexpr (key_interning) {
+            return KeyCodec::intern(key);
+        }
+        else {
+            return KeyCodec::encode(key);
+        }
+    }
+
+    /// \brief retain_key           Adds a reference to an interned Key, if the codec interns Keys
+    static void retain_key(const stored_type& key)
+    {
+        if constexpr (key_interning) {
+            KeyCodec::retain(key);
+        }
+        else {
+            (void)key;
+        }
+    }
+
+    /// \brief release_key          Drops a reference to an interned Key, if the codec interns Keys
+    static void release_key(const stored_type& key)
+    {
+        if constexpr (key_interning) {
+            KeyCodec::release(key);
+        }
+        else {
+            (void)key;
+        }
+    }
+
+    /// \brief encode_key           The encoded form of a Key, kept in scratch unless the codec encodes in place
+    static const stored_type& encode_key(const Key& key, scratch_type& scratch)
     {
-        auto round = m_rounds.find(key);
-        if (round == m_rounds.end()) {
-            return 0;
+        if constexpr (encodes_in_place) {
+            (void)scratch;
+            return KeyCodec::encode(key);
+        }
+        else {
+            scratch = KeyCodec::encode(key);
+            return scratch;
         }
-        return round->second;
+    }
+
+    /// \brief hash_group           Encodes and hashes a group of keys of multi_find. HashFunctions with a
+    ///                             hash_batch (see has_hash_batch) hash the whole group at once, from the
+    ///                             encoded keys gathered into scratch.
+    /// \param keys                 The keys of the batch
+    /// \param first                The position of the first key of the group in the batch
+    /// \param count                The amount of keys of the group, at most prefetch_group
+    /// \param indices              If given, the indices of the keys of the batch, see multi_find
+    /// \param hashes               If given, the hash values of the keys of the batch, see multi_find
+    /// \param scratch              Holds the encoded keys of the group, which the probes refer to
+    /// \param group                Receives the probes of the keys of the group
+    static void hash_group(const Key* keys, size_t first, size_t count, const size_t* indices,
+                           const uint64_t* hashes, scratch_type* scratch, hashed_type* group)
+    {
+        if constexpr (batch_hashing) {
+            if (!hashes) {
+                uint64_t group_hashes[prefetch_group];
+                for (size_t k = 0; k < count; k++) {
+                    scratch[k] = KeyCodec::encode(keys[indices ? indices[first + k] : first + k]);
+                }
+                HashFunction::hash_batch(scratch, count, group_hashes);
+                for (size_t k = 0; k < count; k++) {
+                    group[k] = hashed_type::probe(scratch[k], group_hashes[k]);
+                }
+                return;
+            }
+        }
+        for (size_t k = 0; k < count; k++) {
+            auto i = indices ? indices[first + k] : first + k;
+            auto& encoded = encode_key(keys[i], scratch[k]);
+            group[k] = hashes ? hashed_type::probe(encoded, hashes[i]) : hash_key(encoded);
+        }
+    }
+
+    /// \brief prefetch_nodes       Prefetches the first node of the buckets of a group of keys, in two passes.
+    ///                             The first pass reads the bucket heads of the whole group, which are
+    ///                             independent loads that overlap; the second dereferences them and prefetches
+    ///                             the nodes. std::unordered_map does not expose its bucket array, so the heads
+    ///                             are loaded rather than prefetched.
+    /// \param keys                 The hashed keys of the group
+    /// \param count                The amount of keys of the group, at most prefetch_group
+    void prefetch_nodes(const hashed_type* keys, size_t count) const
+    {
+        size_t buckets[prefetch_group];
+        typename map_type::const_local_iterator heads[prefetch_group];
+        for (size_t k = 0; k < count; k++) {
+            buckets[k] = m_cache.bucket(keys[k]);
+            heads[k] = m_cache.begin(buckets[k]);
+        }
+        for (size_t k = 0; k < count; k++) {
+            if (heads[k] != m_cache.end(buckets[k])) {
+                __builtin_prefetch(&*heads[k]);
+            }
+        }
+    }
+
+    /// \brief find_record  Finds the value of a Key, called with the mutex held, see find
+    std::pair<Value, bool> find_record(const hashed_type& key)
+    {
+        auto item = m_cache.find(key);
+        if (item == m_cache.end()) {
+            if (m_policy) {
+                m_policy->on_miss(key.get());
+            }
+            return std::make_pair(Value{}, false);
+        }
+        if (expired(item->second)) {
+            delete_record(item);
+            if (m_policy) {
+                m_policy->on_miss(key.get());
+            }
+            return std::make_pair(Value{}, false);
+        }
+        if (idle_expiration()) {
+            item->second.last_access = clock_type::now();
+        }
+        if (refresh_due(item->second)) {
+            start_refresh(item->first, item->second);
+        }
+        if (recompute_early(item->second)) {
+            if (m_enable_logs) {
+                std::cout << "Early miss reported ahead of the expiration" << std::endl;
+            }
+            return std::make_pair(Value{}, false);
+        }
+        if (m_policy) {
+            m_policy->on_access(key.get());
+        }
+
+        return std::make_pair(item->second.value, true);
+    }
+
+    /// \brief insert_record        Inserts a key-value pair, called with the mutex held
+    /// \param key                  The Key
+    /// \param value                The Value
+    /// \param expires_at           The expiration time, time_point::max() if the pair never expires
+    /// \param recompute_time       The time it took to compute the value of a new pair, zero if unknown
+    /// \return                     0 if  Key already existed or the pair was rejected, 1 if  Key is newly added
+    size_t insert_record(const hashed_type& key, Value& value, clock_type::time_point expires_at,
+                         std::chrono::nanoseconds recompute_time = std::chrono::nanoseconds::zero())
+    {
+        auto item = m_cache.find(key);
+
+        // an expired pair is replaced as if it did not exist
+        if (item != m_cache.end() && expired(item->second)) {
+            delete_record(item);
+            item = m_cache.end();
+        }
+
+        // in case of new insertion
+        if (item == m_cache.end()) {
+            auto weight = m_weigher(key.get(), value);
+            if (weight > m_max_weight) {
+                if (m_enable_logs) {
+                    std::cout << "Key rejected, its weight exceeds the max weight" << std::endl;
+                }
+                return 0;
+            }
+
+            // increment rounds
+            m_round_counter++;
+
+            // in case of max capacity or max weight, expired pairs go first
+            if (m_wheel.size() && !fits(weight)) {
+                expire_records();
+            }
+            while (!m_cache.empty() && !fits(weight)) {
+                delete_victim();
+            }
+
+            insert_new_record(key, value, weight, expires_at, recompute_time);
+            // the maintenance may already reclaim the new pair, if it expires within a tick
+            count_operation();
+            return 1;
+        }
+
+        // in case of already inserted item, recomputed after an early miss
+        auto& entry = item->second;
+        if (entry.recompute_started != clock_type::time_point()) {
+            auto now = clock_type::now();
+            entry.recompute_time = now - entry.recompute_started;
+            entry.recompute_started = clock_type::time_point();
+            entry.expires_at = expires_at;
+            entry.written_at = now;
+            replace_value(key, entry, value);
+            schedule_expiry(item->first, entry);
+        }
+
+        if (entry.round != m_round_counter) {
+            update_inserted_round(entry);
+        }
+        if (idle_expiration()) {
+            entry.last_access = clock_type::now();
+        }
+        if (m_policy) {
+            m_policy->on_access(key.get());
+        }
+        count_operation();
+        return 0;
+    }
+
+    /// \brief fits                 Indicates whether a pair of a given weight can be inserted without eviction
+    bool fits(size_t weight) const
+    {
+        return m_cache.size() < m_max_size && m_total_weight + weight <= m_max_weight;
+    }
+
+    /// \brief timed                Indicates whether a pair expiring at a given time needs the time it was written
+    ///                             at, i.e. it has a time-to-live or refresh-ahead or time-to-idle is enabled
+    bool timed(clock_type::time_point expires_at) const
+    {
+        return expires_at != clock_type::time_point::max() || idle_expiration() ||
+               m_refresh_after != std::chrono::nanoseconds::zero();
+    }
+
+    /// \brief idle_expiration      Indicates whether pairs expire after a time-to-idle
+    bool idle_expiration() const
+    {
+        return m_time_to_idle != std::chrono::nanoseconds::zero();
+    }
+
+    /// \brief deadline             The time an entry expires at, the earliest of its time-to-live and time-to-idle
+    /// \return                     The expiration time, time_point::max() if the entry never expires
+    clock_type::time_point deadline(const entry_t& entry) const
+    {
+        if (!idle_expiration()) {
+            return entry.expires_at;
+        }
+        return std::min(entry.expires_at, entry.last_access + m_time_to_idle);
+    }
+
+    /// \brief expired              Indicates whether an entry has expired
+    bool expired(const entry_t& entry) const
+    {
+        auto d = deadline(entry);
+        return d != clock_type::time_point::max() && clock_type::now() >= d;
+    }
+
+    /// \brief refresh_due          Indicates whether a read entry should be reloaded in the background
+    bool refresh_due(const entry_t& entry) const
+    {
+        return m_refresh_after != std::chrono::nanoseconds::zero() && m_loader && !entry.refreshing &&
+               clock_type::now() - entry.written_at >= m_refresh_after;
+    }
+
+    /// \brief start_refresh        Reloads an entry asynchronously, called with the mutex held
+    void start_refresh(const hashed_type& key, entry_t& entry)
+    {
+        entry.refreshing = true;
+        // the reference keeps the encoded Key valid should the entry be evicted meanwhile
+        retain_key(key.get());
+        auto loader = m_loader;
+        pool().submit([this, key, loader]() {
+            try {
+                complete_refresh(key, loader(KeyCodec::decode(key.get())));
+            }
+            catch (...) {
+                abort_refresh(key);
+            }
+        });
+    }
+
+    /// \brief pool                 The loader thread pool, created on first use, called with the mutex held
+    thread_pool_t& pool()
+    {
+        if (!m_pool) {
+            m_pool.reset(new thread_pool_t(m_loader_threads));
+        }
+        return *m_pool;
+    }
+
+    /// \brief start_load           Joins the load in flight of a Key, or starts one on the loader threads
+    ///                             through the registered loader, called with the mutex held
+    load_t& start_load(const Key& key, const stored_type& encoded)
+    {
+        auto load = m_loads.find(encoded);
+        if (load != m_loads.end()) {
+            return load->second;
+        }
+
+        auto promise = std::make_shared<std::promise<Value>>();
+        auto registered = register_load(key, promise->get_future().share());
+        if (registered.second) {
+            auto loader = m_loader;
+            pool().submit([this, key, loader, promise]() { run_load(key, loader, *promise); });
+        }
+        return registered.first;
+    }
+
+    /// \brief register_load        Registers the load of a Key, holding a reference to the Key if the codec
+    ///                             interns Keys, called with the mutex held
+    /// \return                     The load of the Key, and whether it was registered rather than already
+    ///                             in flight, in which case the caller must run it
+    std::pair<load_t&, bool> register_load(const Key& key, std::shared_future<Value> result)
+    {
+        decltype(auto) interned = intern_key(key);
+        auto emplaced = m_loads.emplace(interned, load_t{std::move(result), {}});
+        if (!emplaced.second) {
+            // the load in flight holds its own reference
+            release_key(interned);
+        }
+        return std::pair<load_t&, bool>(emplaced.first->second, emplaced.second);
+    }
+
+    /// \brief run_load             Runs a load registered in m_loads, inserts its result, completes its
+    ///                             promise and notifies its waiters, called without holding the mutex
+    void run_load(const Key& key, const loader_type& loader, std::promise<Value>& promise)
+    {
+        std::vector<std::function<void()>> waiters;
+        decltype(auto) encoded = KeyCodec::encode(key);
+        try {
+            auto value = loader(key);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto inserted_value = value;
+                auto hashed = hash_key(encoded);
+                auto expires_at = clock_type::time_point::max();
+                auto item = m_cache.find(hashed);
+                if (item != m_cache.end() && item->second.expires_at != clock_type::time_point::max()) {
+                    // a reload of a pair still cached, e.g. after an early miss, keeps its time-to-live
+                    expires_at = clock_type::now() + (item->second.expires_at - item->second.written_at);
+                }
+                insert_record(hashed, inserted_value, expires_at);
+                waiters = finish_load(encoded);
+            }
+            promise.set_value(std::move(value));
+        }
+        catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                waiters = finish_load(encoded);
+            }
+            promise.set_exception(std::current_exception());
+        }
+        for (auto& waiter : waiters) {
+            waiter();
+        }
+    }
+
+    /// \brief finish_load          Unregisters a load, called with the mutex held
+    /// \return                     The waiters of the load
+    std::vector<std::function<void()>> finish_load(const stored_type& key)
+    {
+        std::vector<std::function<void()>> waiters;
+        auto load = m_loads.find(key);
+        if (load != m_loads.end()) {
+            waiters.swap(load->second.waiters);
+            release_key(load->first);
+            m_loads.erase(load);
+        }
+        return waiters;
+    }
+
+    /// \brief complete_refresh     Replaces the value of a refreshed entry, if it is still the same entry
+    void complete_refresh(const hashed_type& key, Value value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        release_key(key.get());
+        auto item = m_cache.find(key);
+        if (item == m_cache.end() || !item->second.refreshing) {
+            return;
+        }
+        auto& entry = item->second;
+        auto now = clock_type::now();
+        if (entry.expires_at != clock_type::time_point::max()) {
+            entry.expires_at = now + (entry.expires_at - entry.written_at);
+        }
+        entry.written_at = now;
+        entry.refreshing = false;
+        replace_value(key, entry, value);
+        schedule_expiry(item->first, entry);
+
+        if (m_enable_logs) {
+            std::cout << "Key refreshed in the background" << std::endl;
+        }
+    }
+
+    /// \brief recompute_early      Decides whether a read entry is reported as an early miss, and if so
+    ///                             claims its recomputation for the caller
+    bool recompute_early(entry_t& entry)
+    {
+        if (m_early_recomputation <= 0 || entry.expires_at == clock_type::time_point::max() ||
+            entry.recompute_started != clock_type::time_point()) {
+            return false;
+        }
+
+        // XFetch: recompute once now - recompute_time * beta * log(U) reaches the expiration, U in (0, 1]
+        auto now = clock_type::now();
+        auto u = 1.0 - std::uniform_real_distribution<double>(0.0, 1.0)(m_random);
+        auto gap = -std::log(u) * m_early_recomputation * static_cast<double>(entry.recompute_time.count());
+        if (static_cast<double>(std::chrono::nanoseconds(entry.expires_at - now).count()) > gap) {
+            return false;
+        }
+        entry.recompute_started = now;
+        return true;
+    }
+
+    /// \brief replace_value        Replaces the value of an entry and its weight
+    void replace_value(const hashed_type& key, entry_t& entry, Value& value)
+    {
+        auto weight = m_weigher(key.get(), value);
+        m_total_weight = m_total_weight - entry.weight + weight;
+        entry.weight = weight;
+        entry.value = std::move(value);
+    }
+
+    /// \brief abort_refresh        Keeps the current value of an entry whose reload failed
+    void abort_refresh(const hashed_type& key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        release_key(key.get());
+        auto item = m_cache.find(key);
+        if (item != m_cache.end()) {
+            item->second.refreshing = false;
+        }
+    }
+
+    /// \brief schedule_expiry      Tracks the deadline of an entry in the timing wheel
+    /// \param key                  The owning hashed Key of the entry, copied into the wheel
+    void schedule_expiry(const hashed_type& key, const entry_t& entry)
+    {
+        auto d = deadline(entry);
+        if (d != clock_type::time_point::max()) {
+            if (!m_wheel.size()) {
+                // the wheel starts at the first deadline, so that untimed caches never read the clock
+                m_wheel.advance(expiry_tick(clock_type::now()), [](const hashed_type&) {});
+            }
+            m_wheel.schedule(key, expiry_tick(d));
+        }
+        else if (m_wheel.size()) {
+            m_wheel.cancel(key);
+        }
+    }
+
+    /// \brief expiry_tick          The timing wheel tick of a time point, rounded up
+    static uint64_t expiry_tick(clock_type::time_point t)
+    {
+        auto ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+        return (static_cast<uint64_t>(ticks) + 999999) / 1000000;
+    }
+
+    /// \brief expire_records       Reclaims every pair whose time-to-live or time-to-idle has passed.
+    ///                             Pairs read since they were scheduled are rescheduled instead, so that
+    ///                             reads never have to touch the timing wheel.
+    void expire_records()
+    {
+        m_wheel.advance(expiry_tick(clock_type::now()),
+                [this](const hashed_type& key) {
+                    auto item = m_cache.find(key);
+                    if (item == m_cache.end()) {
+                        return;
+                    }
+                    if (expired(item->second)) {
+                        delete_record(item);
+                    }
+                    else {
+                        schedule_expiry(item->first, item->second);
+                    }
+                });
     }
 
     /// \brief update_inserted_round        Updates the round a pair is lastly retrieved/inserted
-    /// \param key                          The key
-    /// \param previously_inserted_round    The round that the pair was orinally inserted or updated
-    void update_inserted_round(const Key& key, size_t previously_inserted_round)
+    /// \param entry                        The entry of the pair
+    void update_inserted_round(entry_t& entry)
     {
+        auto previously_inserted_round = entry.round;
         m_round_counter++;
-        m_rounds[key] = m_round_counter;
-        m_reverse_rounds[m_round_counter] = key;
-        m_reverse_rounds.erase(previously_inserted_round);
+        entry.round = m_round_counter;
+
+        // move the Key to its new round without copying it
+        auto node = m_reverse_rounds.extract(previously_inserted_round);
+        node.key() = m_round_counter;
+        m_reverse_rounds.insert(std::move(node));
         if (previously_inserted_round == m_oldest_insertion) {
             increase_oldest_round();
         }
@@ -198,12 +1212,28 @@ private:
     /// \brief insert_new_record            Inserts a new key-value pair in the look up structures
     /// \param key                          The key
     /// \param value                        The value
-    void insert_new_record(Key& key, Value& value)
+    /// \param weight                       The weight of the pair
+    /// \param expires_at                   The expiration time of the pair
+    /// \param recompute_time               The time it took to compute the value, zero if unknown
+    void insert_new_record(const hashed_type& key, Value& value, size_t weight, clock_type::time_point expires_at,
+                           std::chrono::nanoseconds recompute_time)
     {
-        // insert key-value pair
-        m_cache[key] = value;
-        m_rounds[key] = m_round_counter;
-        m_reverse_rounds[m_round_counter] = key;
+        // insert key-value pair, the clock is only read if the pair can expire or be refreshed
+        auto now = timed(expires_at) ? clock_type::now() : clock_type::time_point();
+        auto last_access = idle_expiration() ? now : clock_type::time_point();
+        auto& item = *m_cache.emplace(key.owned(), entry_t{value, weight, m_round_counter, expires_at, last_access,
+                                                          now, false, recompute_time,
+                                                          clock_type::time_point()}).first;
+        retain_key(item.first.key);
+        schedule_expiry(item.first, item.second);
+        m_total_weight += weight;
+        m_reverse_rounds.emplace(m_round_counter, item.first);
+        if (m_reverse_rounds.size() == 1) {
+            m_oldest_insertion = m_round_counter;
+        }
+        if (m_policy) {
+            m_policy->on_insert(key.get(), weight);
+        }
 
         if (m_enable_logs) {
             std::cout << "New key inserted at round " << m_round_counter << std::endl;
@@ -213,9 +1243,7 @@ private:
     /// \brief delete_least_recent          Evicts a key-value pair from the look up structures
     void delete_least_recent()
     {
-        auto lru_key = m_reverse_rounds[m_oldest_insertion];
-        m_cache.erase(lru_key);
-        m_rounds.erase(lru_key);
+        erase_value(m_cache.find(m_reverse_rounds[m_oldest_insertion]));
         m_reverse_rounds.erase(m_oldest_insertion);
         increase_oldest_round();
 
@@ -225,15 +1253,92 @@ private:
         }
     }
 
+    /// \brief delete_victim                Evicts one key-value pair, chosen by the policy if there is one
+    void delete_victim()
+    {
+        if (m_policy) {
+            delete_policy_victim();
+        }
+        else {
+            delete_least_recent();
+        }
+    }
+
+    /// \brief erase_value                  Removes a pair from the Key->Value hashmap, releasing its weight
+    /// \param item                         The pair
+    void erase_value(typename map_type::iterator item)
+    {
+        m_total_weight -= item->second.weight;
+        if (m_wheel.size()) {
+            m_wheel.cancel(item->first);
+        }
+        release_key(item->first.key);
+        m_cache.erase(item);
+    }
+
+    /// \brief delete_policy_victim         Evicts the key-value pair selected by the eviction policy. If the
+    ///                                     victim is not resident, the policy is out of sync with the cache:
+    ///                                     it is told to forget the victim and the least recent pair is evicted
+    ///                                     instead, so that every call evicts a pair.
+    void delete_policy_victim()
+    {
+        auto victim = m_policy->victim();
+        auto item = m_cache.find(hash_key(victim));
+        if (item == m_cache.end()) {
+            m_policy->on_erase(victim);
+            item = m_cache.find(m_reverse_rounds[m_oldest_insertion]);
+        }
+        delete_record(item);
+
+        if (m_enable_logs) {
+            std::cout << "Max capacity reached, deleted key selected by eviction policy" << std::endl;
+        }
+    }
+
+    /// \brief delete_record                Removes an arbitrary pair from the look up structures
+    /// \param item                         The pair
+    void delete_record(typename map_type::iterator item)
+    {
+        auto round = item->second.round;
+        if (m_policy) {
+            m_policy->on_erase(item->first.key);
+        }
+        erase_value(item);
+        m_reverse_rounds.erase(round);
+        if (round == m_oldest_insertion) {
+            increase_oldest_round();
+        }
+    }
+
     /// \brief Finds the next oldest inserted round
     void increase_oldest_round()
     {
         m_oldest_insertion++;
-        while(m_reverse_rounds.find(m_oldest_insertion) == m_reverse_rounds.end()) {
+        while(!m_reverse_rounds.empty() &&
+              m_reverse_rounds.find(m_oldest_insertion) == m_reverse_rounds.end()) {
             m_oldest_insertion++;
         }
     }
 
+    /// \brief count_operation              Runs the maintenance every default_maintenance_interval insertions
+    void count_operation()
+    {
+        if (++m_operations % default_maintenance_interval == 0) {
+            maintenance();
+        }
+    }
+
+    /// \brief maintenance                  Periodic housekeeping, called with the mutex held
+    void maintenance()
+    {
+        if (m_wheel.size()) {
+            expire_records();
+        }
+        if (m_policy) {
+            m_policy->maintenance();
+        }
+    }
+
     template<class T>
     /// \brief default_print                Default print method (for debugging purposes)
     /// \param t                            A simple type to by printed
@@ -242,12 +1347,10 @@ private:
         std::cout << t;
     }
 
-    /// \brief m_cache                      The Key->Value hashmap
-    std::unordered_map<Key, Value, HashFunction, KeyEqual, Allocator>   m_cache;
-    /// \brief m_rounds                     The Key->insertion/lookup round hashmap
-    std::unordered_map<Key, size_t, HashFunction, KeyEqual>             m_rounds;
+    /// \brief m_cache                      The Key->Value and insertion/lookup round hashmap
+    map_type m_cache;
     /// \brief m_reverse_rounds             The insertion/lookup round ->Key hashmap
-    std::unordered_map<size_t, Key>                                     m_reverse_rounds;
+    std::unordered_map<size_t, hashed_type>                             m_reverse_rounds;
     /// \brief m_round_counter              The total amound of insertions/updates
     size_t m_round_counter;
     /// \brief m_oldest_insertion           The inseriton round of the oldest pair
@@ -256,7 +1359,46 @@ private:
     size_t m_max_size;
     /// \brief m_enable_logs                Enable/disable verbocity
     bool m_enable_logs;
+    /// \brief m_policy                     Optional eviction policy, the built-in LRU is used if null
+    std::unique_ptr<eviction_policy_t<stored_type>> m_policy;
+    /// \brief m_weigher                    Measures the weight of the pairs
+    Weigher m_weigher;
+    /// \brief m_max_weight                 The maximum total weight of the cache
+    size_t m_max_weight;
+    /// \brief m_total_weight               The total weight of the inserted pairs
+    size_t m_total_weight;
+    /// \brief m_time_to_idle               The maximum idle time of the pairs, zero if they never idle out
+    std::chrono::nanoseconds m_time_to_idle;
+    /// \brief m_loader                     Reloads pairs in the background, if refresh-ahead is enabled
+    loader_type m_loader;
+    /// \brief m_refresh_after              The age after which pairs are refreshed, zero if never
+    std::chrono::nanoseconds m_refresh_after;
+    /// \brief m_loader_threads             The amount of threads of m_pool
+    size_t m_loader_threads;
+    /// \brief m_pool                       Runs the background loads and refreshes, created on first use
+    std::unique_ptr<thread_pool_t> m_pool;
+    /// \brief m_loads                      The loads in flight, by encoded Key
+    std::unordered_map<stored_type, load_t, HashFunction, KeyEqual> m_loads;
+    /// \brief m_early_recomputation        The XFetch beta, zero if early recomputation is disabled
+    double m_early_recomputation;
+    /// \brief m_random                     Draws the early recomputations
+    std::mt19937_64 m_random;
+    /// \brief m_wheel                      Expiration times of the pairs that can expire
+    timing_wheel_t<hashed_type, stored_hash, hashed_key_equal<KeyEqual>> m_wheel;
+    /// \brief m_operations                 The total amount of insertions, drives the maintenance
+    size_t m_operations;
     /// \brief m_mutex                      Mutex to handle reads/writes of multiple threads
     std::mutex m_mutex;
 
 };
+
+template<
+    class Key,
+    class Value,
+    class KeyCodec,
+    class HashFunction=std::hash<typename KeyCodec::encoded_type>
+>
+/// \brief EncodedCache A Cache whose Keys are stored in the form of a KeyCodec, hashed with a HashFunction of the
+/// encoded Keys, e.g. EncodedCache<std::pair<std::string, std::string>, size_t, symbol_date_codec, fixed_width_hash>
+using EncodedCache = Cache<Key, Value, HashFunction, std::equal_to<typename KeyCodec::encoded_type>,
+                           std::allocator<std::pair<const Key, Value>>, unit_weigher, KeyCodec>;
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/// \brief default_coarse_clock_resolution Default period at which the coarse clock is refreshed
+static const std::chrono::milliseconds default_coarse_clock_resolution(1);
+
+/// \brief The coarse_clock_t class A cached, coarse-grained view of std::chrono::steady_clock.
+/// A ticker thread refreshes the cached time every default_coarse_clock_resolution, so that now() is a
+/// single relaxed atomic load instead of a clock read. The time points are steady_clock time points, only
+/// up to one resolution period old. The ticker is started on first use and stopped at program exit.
+class coarse_clock_t
+{
+public:
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static const bool is_steady = true;
+
+    /// \brief now          Returns the cached time
+    /// \return             A steady_clock time point, at most one resolution period old
+    static time_point now()
+    {
+        return time_point(duration(instance().m_now.load(std::memory_order_relaxed)));
+    }
+
+    /// \brief Disable copy constructor
+    coarse_clock_t(const coarse_clock_t&) = delete;
+    /// \brief Disable copy assignment operator
+    coarse_clock_t& operator=(const coarse_clock_t&) = delete;
+
+private:
+    coarse_clock_t()
+        : m_now(std::chrono::steady_clock::now().time_since_epoch().count()),
+          m_stop(false),
+          m_ticker(
+                [this]() {
+                    while (!m_stop.load(std::memory_order_relaxed)) {
+                        std::this_thread::sleep_for(default_coarse_clock_resolution);
+                        m_now.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                    std::memory_order_relaxed);
+                    }
+                })
+    {}
+
+    ~coarse_clock_t()
+    {
+        m_stop.store(true, std::memory_order_relaxed);
+        m_ticker.join();
+    }
+
+    /// \brief instance     The process-wide clock
+    static coarse_clock_t& instance()
+    {
+        static coarse_clock_t clock;
+        return clock;
+    }
+
+    /// \brief m_now        The cached time, in steady_clock ticks
+    std::atomic<rep> m_now;
+    /// \brief m_stop       Stops the ticker
+    std::atomic<bool> m_stop;
+    /// \brief m_ticker     Refreshes m_now
+    std::thread m_ticker;
+};
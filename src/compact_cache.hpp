@@ -0,0 +1,342 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "coarse_clock.hpp"
+#include "hashing.hpp"
+
+/// \brief default_second_chances Default amount of frequently used pairs CompactCache spares per eviction
+static const size_t default_second_chances = 8;
+
+template<
+    class Key,
+    class Value,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The CompactCache class An LRU cache with a small, fixed per-pair overhead, for very large amounts of
+/// small pairs. Pairs live in nodes of preallocated arrays, referred to by 32-bit indices: an open-addressing
+/// index of at least two buckets per pair (linear probing, backward-shift deletion) and a recency list of
+/// 32-bit links. The metadata of a pair is packed into a single 64-bit word: its expiration time, a frequency
+/// counter, a fingerprint of its hash and flags. The hot metadata (words and links) is stored apart from the
+/// cold key-value payload, so that probes and evictions only touch the payload of the pairs they compare.
+/// The per-pair overhead is 24 to 32 bytes, instead of the three hashmap nodes and bucket slots of Cache.
+/// Eviction is frequency-aware LRU: the least recently used pair is spared, up to default_second_chances
+/// times per eviction, if it was read since it was last spared; its counter is halved and it becomes the most
+/// recent pair. Expired pairs are reported as missing and reclaimed on access or when they are evicted.
+class CompactCache
+{
+public:
+    /// \brief clock_type   The clock expiration times are measured with, see Cache::clock_type
+    using clock_type = coarse_clock_t;
+
+    /// \brief CompactCache Constructor, allocates the storage of all pairs
+    /// \param max_size     The maximum capacity of the cache, below 2^32 - 1
+    explicit CompactCache(size_t max_size)
+        : m_capacity(max_size ? max_size : 1),
+          m_head(nil),
+          m_tail(nil),
+          m_size(0),
+          m_epoch()
+    {
+        if (m_capacity >= nil) {
+            throw std::length_error("CompactCache supports less than 2^32 - 1 pairs");
+        }
+        size_t buckets = 2;
+        while (buckets < 2 * m_capacity) {
+            buckets <<= 1;
+        }
+        m_bucket_mask = buckets - 1;
+        m_buckets.assign(buckets, nil);
+        m_meta.assign(m_capacity, 0);
+        m_links.resize(m_capacity);
+        m_payload.reserve(m_capacity);
+    }
+
+    /// \brief Disable copy constructor
+    CompactCache(const CompactCache&) = delete;
+    /// \brief Disable copy assignment operator
+    CompactCache& operator=(const CompactCache&) = delete;
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size;
+    }
+
+    /// \brief capacity     Returns the maximum amount of key-value pairs
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists, and marks it most recently used
+    /// \param key          The Key
+    /// \return             Returns an std::pair<Value, bool>, see Cache::find
+    std::pair<Value, bool> find(const Key& key)
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto bucket = lookup(key, hash);
+        auto node = m_buckets[bucket];
+        if (node == nil) {
+            return std::make_pair(Value{}, false);
+        }
+        if (expired(node, now_tick())) {
+            remove(bucket, node);
+            return std::make_pair(Value{}, false);
+        }
+        auto& meta = m_meta[node];
+        if (frequency(meta) < max_frequency) {
+            meta += uint64_t(1) << frequency_shift;
+        }
+        touch(node);
+        return std::make_pair(m_payload[node].second, true);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair that never expires, see insert
+    size_t insert(Key key, Value value)
+    {
+        return insert(std::move(key), std::move(value), std::chrono::nanoseconds::zero());
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair. If the cache is full, a pair is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \param time_to_live The time after which the pair expires, zero if it never expires. Updating a pair
+    ///                     restarts its time-to-live.
+    /// \return             0 if Key already existed, 1 if Key is newly added
+    size_t insert(Key key, Value value, std::chrono::nanoseconds time_to_live)
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (time_to_live > std::chrono::nanoseconds::zero() && m_epoch == clock_type::time_point()) {
+            // the clock is only read once pairs can expire
+            m_epoch = clock_type::now();
+        }
+        auto now = now_tick();
+        auto bucket = lookup(key, hash);
+        auto node = m_buckets[bucket];
+        if (node != nil && expired(node, now)) {
+            remove(bucket, node);
+            bucket = lookup(key, hash);
+            node = nil;
+        }
+        if (node != nil) {
+            m_payload[node].second = std::move(value);
+            m_meta[node] = (m_meta[node] & ~expiry_mask) | expiry(now, time_to_live);
+            touch(node);
+            return 0;
+        }
+
+        if (m_size == m_capacity) {
+            evict(now);
+            // the eviction may have shifted the probe sequence of the key
+            bucket = lookup(key, hash);
+        }
+        node = allocate(std::move(key), std::move(value));
+        m_meta[node] = occupied | (fingerprint(hash) << fingerprint_shift) | expiry(now, time_to_live);
+        m_buckets[bucket] = node;
+        push_front(node);
+        m_size++;
+        return 1;
+    }
+
+private:
+    /// \brief The links_t struct   The neighbours of a node in the recency list
+    struct links_t
+    {
+        /// \brief newer            The next more recently used node, nil for the head
+        uint32_t newer;
+        /// \brief older            The next less recently used node, nil for the tail
+        uint32_t older;
+    };
+
+    /// \brief nil                  Marks an empty bucket and the ends of the recency list
+    static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+
+    // Layout of a metadata word, from the least significant bit:
+    // | expiry 44 | frequency 4 | fingerprint 12 | flags 4 |
+    /// \brief expiry_mask          Milliseconds since m_epoch + 1 at which the pair expires, 0 if never
+    static constexpr uint64_t expiry_mask = (uint64_t(1) << 44) - 1;
+    static constexpr size_t frequency_shift = 44;
+    /// \brief max_frequency        The saturation value of the frequency counter
+    static constexpr uint64_t max_frequency = 15;
+    static constexpr size_t fingerprint_shift = 48;
+    static constexpr uint64_t fingerprint_mask = 0xfff;
+    /// \brief occupied             Flag of the nodes holding a pair
+    static constexpr uint64_t occupied = uint64_t(1) << 60;
+
+    static uint64_t frequency(uint64_t meta)
+    {
+        return (meta >> frequency_shift) & max_frequency;
+    }
+
+    /// \brief fingerprint          The 12 bits of a hash compared before the Keys, independent of its bucket
+    static uint64_t fingerprint(uint64_t hash)
+    {
+        return hash >> (64 - 12);
+    }
+
+    /// \brief now_tick             The milliseconds elapsed since m_epoch, 0 until a pair was given a time-to-live
+    uint64_t now_tick() const
+    {
+        if (m_epoch == clock_type::time_point()) {
+            return 0;
+        }
+        return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - m_epoch).count());
+    }
+
+    /// \brief expiry               The expiry field of a pair inserted now, rounded up to whole milliseconds
+    static uint64_t expiry(uint64_t now, std::chrono::nanoseconds time_to_live)
+    {
+        if (time_to_live <= std::chrono::nanoseconds::zero()) {
+            return 0;
+        }
+        auto ttl = static_cast<uint64_t>((time_to_live.count() + 999999) / 1000000);
+        return std::min(now + ttl + 1, expiry_mask);
+    }
+
+    /// \brief expired              Indicates whether the pair of a node has expired
+    bool expired(uint32_t node, uint64_t now) const
+    {
+        auto e = m_meta[node] & expiry_mask;
+        return e != 0 && now + 1 >= e;
+    }
+
+    /// \brief lookup               The bucket holding a key, or the empty bucket ending its probe sequence
+    size_t lookup(const Key& key, uint64_t hash) const
+    {
+        auto bucket = static_cast<size_t>(hash) & m_bucket_mask;
+        auto print = fingerprint(hash);
+        while (m_buckets[bucket] != nil) {
+            auto node = m_buckets[bucket];
+            if (((m_meta[node] >> fingerprint_shift) & fingerprint_mask) == print &&
+                KeyEqual{}(m_payload[node].first, key)) {
+                break;
+            }
+            bucket = (bucket + 1) & m_bucket_mask;
+        }
+        return bucket;
+    }
+
+    /// \brief home                 The first bucket probed for the Key of a node
+    size_t home(uint32_t node) const
+    {
+        return static_cast<size_t>(mix_hash(HashFunction{}(m_payload[node].first))) & m_bucket_mask;
+    }
+
+    /// \brief erase_bucket         Empties a bucket, shifting back the following entries of the cluster that
+    ///                             can move closer to their home, see StaticCache
+    void erase_bucket(size_t hole)
+    {
+        auto next = (hole + 1) & m_bucket_mask;
+        while (m_buckets[next] != nil) {
+            if (((next - home(m_buckets[next])) & m_bucket_mask) >= ((next - hole) & m_bucket_mask)) {
+                m_buckets[hole] = m_buckets[next];
+                hole = next;
+            }
+            next = (next + 1) & m_bucket_mask;
+        }
+        m_buckets[hole] = nil;
+    }
+
+    /// \brief allocate             Stores a pair in a free node
+    uint32_t allocate(Key key, Value value)
+    {
+        if (!m_free.empty()) {
+            auto node = m_free.back();
+            m_free.pop_back();
+            m_payload[node] = std::make_pair(std::move(key), std::move(value));
+            return node;
+        }
+        m_payload.emplace_back(std::move(key), std::move(value));
+        return static_cast<uint32_t>(m_payload.size() - 1);
+    }
+
+    /// \brief remove               Removes the pair of a node, given its bucket
+    void remove(size_t bucket, uint32_t node)
+    {
+        unlink(node);
+        erase_bucket(bucket);
+        m_meta[node] = 0;
+        m_free.push_back(node);
+        m_size--;
+    }
+
+    /// \brief evict                Removes the least recently used pair, sparing recently read ones
+    void evict(uint64_t now)
+    {
+        for (size_t chance = 0; ; chance++) {
+            auto node = m_tail;
+            auto& meta = m_meta[node];
+            auto f = frequency(meta);
+            if (f == 0 || chance == default_second_chances || expired(node, now)) {
+                auto hash = mix_hash(HashFunction{}(m_payload[node].first));
+                remove(lookup(m_payload[node].first, hash), node);
+                return;
+            }
+            meta = (meta & ~(max_frequency << frequency_shift)) | ((f >> 1) << frequency_shift);
+            touch(node);
+        }
+    }
+
+    /// \brief unlink               Removes a node from the recency list
+    void unlink(uint32_t node)
+    {
+        auto& l = m_links[node];
+        (l.newer != nil ? m_links[l.newer].older : m_head) = l.older;
+        (l.older != nil ? m_links[l.older].newer : m_tail) = l.newer;
+    }
+
+    /// \brief push_front           Makes a node the head of the recency list
+    void push_front(uint32_t node)
+    {
+        m_links[node].newer = nil;
+        m_links[node].older = m_head;
+        (m_head != nil ? m_links[m_head].newer : m_tail) = node;
+        m_head = node;
+    }
+
+    /// \brief touch                Marks a node most recently used
+    void touch(uint32_t node)
+    {
+        if (node != m_head) {
+            unlink(node);
+            push_front(node);
+        }
+    }
+
+    /// \brief m_capacity           The maximum amount of pairs
+    size_t m_capacity;
+    /// \brief m_bucket_mask        The amount of buckets minus one, a power of two of at least 2 * m_capacity
+    size_t m_bucket_mask;
+    /// \brief m_buckets            The index, node indices by bucket
+    std::vector<uint32_t> m_buckets;
+    /// \brief m_meta               The packed metadata word of every node, 0 for free nodes
+    std::vector<uint64_t> m_meta;
+    /// \brief m_links              The recency list links of every node
+    std::vector<links_t> m_links;
+    /// \brief m_payload            The key-value pair of every node, grown up to m_capacity
+    std::vector<std::pair<Key, Value>> m_payload;
+    /// \brief m_free               The free nodes below m_payload.size()
+    std::vector<uint32_t> m_free;
+    /// \brief m_head               The most recently used node
+    uint32_t m_head;
+    /// \brief m_tail               The least recently used node
+    uint32_t m_tail;
+    /// \brief m_size               The amount of inserted key-value pairs
+    size_t m_size;
+    /// \brief m_epoch              The origin of the expiration times, set by the first time-to-live
+    clock_type::time_point m_epoch;
+    /// \brief m_mutex              Mutex to handle reads/writes of multiple threads
+    std::mutex m_mutex;
+};
@@ -0,0 +1,388 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hashing.hpp"
+
+/// \brief default_version_stripes Default amount of version counters shared by the buckets
+static const size_t default_version_stripes = 2048;
+
+/// \brief default_cuckoo_search Default maximum amount of buckets visited when searching a cuckoo path
+static const size_t default_cuckoo_search = 512;
+
+template<
+    class Key,
+    class Value,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The ConcurrentCache class A read-mostly concurrent cache in the style of MemC3.
+/// The index is an optimistic cuckoo hash table of 4-way buckets. Each key has two candidate buckets and
+/// a one byte tag, so that a lookup compares full keys only on tag matches. Readers never lock: every
+/// bucket is covered by a striped version counter that writers make odd while they modify it, and a
+/// reader retries if a version changed while it copied the entry. Writers are serialized by a single
+/// writer mutex; an insertion into two full buckets moves entries along a cuckoo path found by BFS.
+/// Eviction is approximated by CLOCK: readers set a reference bit and the clock hand evicts the first
+/// entry whose bit is not set.
+/// Since entries are copied concurrently to updates, Key and Value must be trivially copyable.
+/// Tags, keys and values are stored in separate parallel arrays (structure of arrays): the CLOCK sweep only
+/// touches tags and reference bits, probes only touch the keys of matching tags, and whole-cache passes such
+/// as snapshot read each array contiguously.
+class ConcurrentCache
+{
+    static_assert(std::is_trivially_copyable<Key>::value, "ConcurrentCache requires a trivially copyable Key");
+    static_assert(std::is_trivially_copyable<Value>::value, "ConcurrentCache requires a trivially copyable Value");
+
+public:
+    /// \brief ConcurrentCache      Constructor
+    /// \param max_size             The maximum capacity of the cache
+    explicit ConcurrentCache(size_t max_size)
+        : m_max_size(max_size ? max_size : 1),
+          m_versions(default_version_stripes),
+          m_hand(0),
+          m_size(0)
+    {
+        // keep the table at most ~90% full so that cuckoo paths stay short
+        size_t buckets = 2;
+        while (buckets * slots_per_bucket * 9 < m_max_size * 10) {
+            buckets <<= 1;
+        }
+        m_bucket_mask = buckets - 1;
+        m_tags.assign(buckets * slots_per_bucket, 0);
+        m_keys.resize(buckets * slots_per_bucket);
+        m_values.resize(buckets * slots_per_bucket);
+        m_references = std::vector<std::atomic<uint8_t>>(buckets * slots_per_bucket);
+        for (auto& version : m_versions) {
+            version.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// \brief Disable copy constructor
+    ConcurrentCache(const ConcurrentCache&) = delete;
+    /// \brief Disable copy assignment operator
+    ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    size_t size() const
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists. Never blocks.
+    /// \param key          The Key
+    /// \return             Returns an std::pair<Value, bool>, see Cache::find
+    std::pair<Value, bool> find(const Key& key) const
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        auto t = tag(hash);
+        size_t buckets[2] = {hash & m_bucket_mask, alternate(hash & m_bucket_mask, t)};
+        auto& v0 = version(buckets[0]);
+        auto& v1 = version(buckets[1]);
+
+        while (true) {
+            auto before0 = v0.load(std::memory_order_acquire);
+            auto before1 = v1.load(std::memory_order_acquire);
+            if ((before0 | before1) & 1) {
+                continue;
+            }
+
+            bool found = false;
+            size_t found_slot = 0;
+            Value value{};
+            for (auto b : buckets) {
+                for (auto slot = b * slots_per_bucket; slot < (b + 1) * slots_per_bucket && !found; slot++) {
+                    if (load_relaxed(m_tags[slot]) != t) {
+                        continue;
+                    }
+                    Key candidate;
+                    std::memcpy(static_cast<void*>(&candidate), &m_keys[slot], sizeof(Key));
+                    if (KeyEqual{}(candidate, key)) {
+                        std::memcpy(static_cast<void*>(&value), &m_values[slot], sizeof(Value));
+                        found = true;
+                        found_slot = slot;
+                    }
+                }
+                if (found) {
+                    break;
+                }
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (v0.load(std::memory_order_relaxed) != before0 || v1.load(std::memory_order_relaxed) != before1) {
+                continue;
+            }
+            if (!found) {
+                return std::make_pair(Value{}, false);
+            }
+            auto& reference = m_references[found_slot];
+            if (!reference.load(std::memory_order_relaxed)) {
+                reference.store(1, std::memory_order_relaxed);
+            }
+            return std::make_pair(value, true);
+        }
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair. If max capacity is reached, an entry
+    ///                     chosen by the CLOCK hand is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed, 1 if Key is newly added
+    size_t insert(const Key& key, const Value& value)
+    {
+        std::lock_guard<std::mutex> lock(m_writer);
+        auto hash = mix_hash(HashFunction{}(key));
+        auto t = tag(hash);
+        size_t buckets[2] = {hash & m_bucket_mask, alternate(hash & m_bucket_mask, t)};
+
+        for (auto b : buckets) {
+            for (auto slot = b * slots_per_bucket; slot < (b + 1) * slots_per_bucket; slot++) {
+                if (m_tags[slot] == t && KeyEqual{}(m_keys[slot], key)) {
+                    write_slot(slot, t, key, value);
+                    return 0;
+                }
+            }
+        }
+
+        if (m_size.load(std::memory_order_relaxed) >= m_max_size) {
+            evict_clock();
+        }
+
+        size_t slot = free_slot(buckets[0], buckets[1]);
+        if (slot == npos) {
+            // no cuckoo path; sacrifice an entry of the first candidate bucket
+            slot = buckets[0] * slots_per_bucket + clock_victim_in(buckets[0]);
+            erase_slot(slot);
+        }
+        write_slot(slot, t, key, value);
+        m_references[slot].store(0, std::memory_order_relaxed);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        return 1;
+    }
+
+    /// \brief snapshot     Copies all key-value pairs, e.g. to persist or inspect the cache. Readers are not
+    ///                     blocked; writers wait for the copy, so that it is consistent.
+    /// \param keys         Receives the keys
+    /// \param values       Receives the value of the i-th key at index i
+    /// \return             The amount of pairs
+    size_t snapshot(std::vector<Key>& keys, std::vector<Value>& values)
+    {
+        std::lock_guard<std::mutex> lock(m_writer);
+        keys.clear();
+        values.clear();
+        keys.reserve(m_size.load(std::memory_order_relaxed));
+        values.reserve(m_size.load(std::memory_order_relaxed));
+        for (size_t slot = 0; slot < m_tags.size(); slot++) {
+            if (m_tags[slot]) {
+                keys.push_back(m_keys[slot]);
+                values.push_back(m_values[slot]);
+            }
+        }
+        return keys.size();
+    }
+
+private:
+    /// \brief slots_per_bucket     Associativity of a bucket
+    static const size_t slots_per_bucket = 4;
+    /// \brief npos                 Invalid slot
+    static const size_t npos = ~size_t(0);
+
+    /// \brief The path_node_t struct   A bucket visited by the cuckoo path BFS
+    struct path_node_t
+    {
+        size_t bucket;
+        size_t parent;
+        size_t parent_slot;
+    };
+
+    static uint8_t load_relaxed(const uint8_t& byte)
+    {
+        return reinterpret_cast<const std::atomic<uint8_t>&>(byte).load(std::memory_order_relaxed);
+    }
+
+    /// \brief tag                  The non-zero tag byte of a hash
+    static uint8_t tag(uint64_t hash)
+    {
+        auto t = static_cast<uint8_t>(hash >> 56);
+        return t ? t : 1;
+    }
+
+    /// \brief alternate            The other candidate bucket of an entry, computable from its tag only
+    size_t alternate(size_t bucket, uint8_t t) const
+    {
+        return (bucket ^ mix_hash(t)) & m_bucket_mask;
+    }
+
+    /// \brief version              The version counter covering a bucket
+    std::atomic<uint32_t>& version(size_t bucket) const
+    {
+        return m_versions[bucket % m_versions.size()];
+    }
+
+    /// \brief begin_write          Makes the version of a bucket odd before it is modified
+    void begin_write(size_t bucket)
+    {
+        auto& v = version(bucket);
+        v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /// \brief end_write            Makes the version of a bucket even again after it was modified
+    void end_write(size_t bucket)
+    {
+        auto& v = version(bucket);
+        v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// \brief write_slot           Stores an entry in a slot
+    void write_slot(size_t slot, uint8_t t, const Key& key, const Value& value)
+    {
+        auto bucket = slot / slots_per_bucket;
+        begin_write(bucket);
+        std::memcpy(static_cast<void*>(&m_keys[slot]), &key, sizeof(Key));
+        std::memcpy(static_cast<void*>(&m_values[slot]), &value, sizeof(Value));
+        reinterpret_cast<std::atomic<uint8_t>&>(m_tags[slot]).store(t, std::memory_order_relaxed);
+        end_write(bucket);
+    }
+
+    /// \brief erase_slot           Empties a slot
+    void erase_slot(size_t slot)
+    {
+        auto bucket = slot / slots_per_bucket;
+        begin_write(bucket);
+        reinterpret_cast<std::atomic<uint8_t>&>(m_tags[slot]).store(0, std::memory_order_relaxed);
+        end_write(bucket);
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// \brief move_slot            Moves an entry to an empty slot of its alternate bucket.
+    ///                             Both buckets are modified under odd versions, so a concurrent reader
+    ///                             either sees the entry or retries.
+    void move_slot(size_t from_bucket, size_t from_slot, size_t to_bucket, size_t to_slot)
+    {
+        auto from = from_bucket * slots_per_bucket + from_slot;
+        auto to = to_bucket * slots_per_bucket + to_slot;
+        begin_write(from_bucket);
+        if (version_stripe(from_bucket) != version_stripe(to_bucket)) {
+            begin_write(to_bucket);
+        }
+        std::memcpy(static_cast<void*>(&m_keys[to]), &m_keys[from], sizeof(Key));
+        std::memcpy(static_cast<void*>(&m_values[to]), &m_values[from], sizeof(Value));
+        reinterpret_cast<std::atomic<uint8_t>&>(m_tags[to]).store(m_tags[from], std::memory_order_relaxed);
+        reinterpret_cast<std::atomic<uint8_t>&>(m_tags[from]).store(0, std::memory_order_relaxed);
+        m_references[to].store(m_references[from].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if (version_stripe(from_bucket) != version_stripe(to_bucket)) {
+            end_write(to_bucket);
+        }
+        end_write(from_bucket);
+    }
+
+    size_t version_stripe(size_t bucket) const
+    {
+        return bucket % m_versions.size();
+    }
+
+    /// \brief free_slot            Finds or makes (via a cuckoo path) an empty slot in one of two buckets
+    /// \return                     The global slot index, npos if no path was found
+    size_t free_slot(size_t first, size_t second)
+    {
+        std::vector<path_node_t> nodes{{first, npos, 0}, {second, npos, 0}};
+        for (size_t n = 0; n < nodes.size() && n < default_cuckoo_search; n++) {
+            auto bucket = nodes[n].bucket;
+            for (size_t s = 0; s < slots_per_bucket; s++) {
+                if (m_tags[bucket * slots_per_bucket + s] == 0) {
+                    return shift_path(nodes, n, s);
+                }
+            }
+            for (size_t s = 0; s < slots_per_bucket; s++) {
+                auto next = alternate(bucket, m_tags[bucket * slots_per_bucket + s]);
+                if (!on_path(nodes, n, next)) {
+                    nodes.push_back(path_node_t{next, n, s});
+                }
+            }
+        }
+        return npos;
+    }
+
+    /// \brief on_path              Indicates whether a bucket is already on the path leading to a node
+    static bool on_path(const std::vector<path_node_t>& nodes, size_t node, size_t bucket)
+    {
+        for (; node != npos; node = nodes[node].parent) {
+            if (nodes[node].bucket == bucket) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief shift_path           Moves the entries along a cuckoo path, freeing a slot in its root bucket
+    /// \param nodes                The BFS nodes
+    /// \param node                 The node whose bucket has an empty slot
+    /// \param slot                 The empty slot
+    /// \return                     The freed global slot index
+    size_t shift_path(const std::vector<path_node_t>& nodes, size_t node, size_t slot)
+    {
+        while (nodes[node].parent != npos) {
+            auto& child = nodes[node];
+            move_slot(nodes[child.parent].bucket, child.parent_slot, child.bucket, slot);
+            slot = child.parent_slot;
+            node = child.parent;
+        }
+        return nodes[node].bucket * slots_per_bucket + slot;
+    }
+
+    /// \brief evict_clock          Advances the CLOCK hand until an unreferenced entry is found and evicts it
+    void evict_clock()
+    {
+        auto slots = m_references.size();
+        while (true) {
+            auto slot = m_hand;
+            m_hand = (m_hand + 1) % slots;
+            if (m_tags[slot] == 0) {
+                continue;
+            }
+            if (m_references[slot].exchange(0, std::memory_order_relaxed)) {
+                continue;
+            }
+            erase_slot(slot);
+            return;
+        }
+    }
+
+    /// \brief clock_victim_in      An unreferenced slot of a full bucket, the first one if all are referenced
+    size_t clock_victim_in(size_t bucket)
+    {
+        for (size_t s = 0; s < slots_per_bucket; s++) {
+            if (!m_references[bucket * slots_per_bucket + s].load(std::memory_order_relaxed)) {
+                return s;
+            }
+        }
+        return 0;
+    }
+
+    /// \brief m_max_size           The maximum capacity of the cache
+    size_t m_max_size;
+    /// \brief m_bucket_mask        The amount of buckets minus one
+    size_t m_bucket_mask;
+    /// \brief m_tags               The tag of every slot, 0 marks an empty slot. The slots of a bucket are
+    ///                             consecutive in m_tags, m_keys and m_values.
+    std::vector<uint8_t> m_tags;
+    /// \brief m_keys               The key of every slot
+    std::vector<Key> m_keys;
+    /// \brief m_values             The value of every slot
+    std::vector<Value> m_values;
+    /// \brief m_references         CLOCK reference bit per slot
+    mutable std::vector<std::atomic<uint8_t>> m_references;
+    /// \brief m_versions           Striped version counters, odd while a covered bucket is modified
+    mutable std::vector<std::atomic<uint32_t>> m_versions;
+    /// \brief m_hand               The CLOCK hand
+    size_t m_hand;
+    /// \brief m_size               The amount of inserted key-value pairs
+    std::atomic<size_t> m_size;
+    /// \brief m_writer             Serializes writers
+    std::mutex m_writer;
+};
@@ -0,0 +1,201 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/// \brief The identity_slot struct Default key-to-slot functor of DirectMappedCache, integer Keys are their slot
+struct identity_slot
+{
+    template<class K>
+    size_t operator() (const K& key) const
+    {
+        return static_cast<size_t>(key);
+    }
+};
+
+template<
+    class Key,
+    class Value,
+    class KeyToSlot=identity_slot
+>
+/// \brief The DirectMappedCache class An LRU cache for dense integer Keys, e.g. day indices or instrument ids in
+/// [0, N). The KeyToSlot functor maps every Key to its own slot in [0, N), and every slot owns its value and
+/// its links in the recency list, so there is no hashing and no collision handling: a lookup is one indexed
+/// access. At most max_size slots are resident at a time; inserting into a full cache evicts the least
+/// recently used resident slot and releases its value. Keys whose slot is out of range are never cached.
+/// A one-byte spinlock synchronizes the cache.
+class DirectMappedCache
+{
+public:
+    /// \brief DirectMappedCache    Constructor, allocates the storage of all slots
+    /// \param slots                The amount of slots N, below 2^32 - 2
+    /// \param max_size             The maximum amount of resident slots, all of them if zero
+    explicit DirectMappedCache(size_t slots, size_t max_size = 0)
+        : m_max_size(max_size && max_size < slots ? max_size : slots),
+          m_head(nil),
+          m_tail(nil),
+          m_size(0),
+          m_lock(0)
+    {
+        if (slots >= absent) {
+            throw std::length_error("DirectMappedCache supports less than 2^32 - 2 slots");
+        }
+        m_values.resize(slots);
+        m_links.assign(slots, links_t{absent, absent});
+    }
+
+    /// \brief Disable copy constructor
+    DirectMappedCache(const DirectMappedCache&) = delete;
+    /// \brief Disable copy assignment operator
+    DirectMappedCache& operator=(const DirectMappedCache&) = delete;
+
+    /// \brief size         Returns the amount of resident slots
+    size_t size() const
+    {
+        lock_t lock(m_lock);
+        return m_size;
+    }
+
+    /// \brief capacity     Returns the maximum amount of resident slots
+    size_t capacity() const
+    {
+        return m_max_size;
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists, and marks it most recently used
+    /// \param key          The Key
+    /// \return             Returns an std::pair<Value, bool>, see Cache::find
+    std::pair<Value, bool> find(const Key& key)
+    {
+        auto slot = KeyToSlot{}(key);
+        if (slot >= m_links.size()) {
+            return std::make_pair(Value{}, false);
+        }
+        lock_t lock(m_lock);
+        if (m_links[slot].newer == absent) {
+            return std::make_pair(Value{}, false);
+        }
+        touch(static_cast<uint32_t>(slot));
+        return std::make_pair(m_values[slot], true);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair. If the cache is full, the least recently used
+    ///                     pair is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed or its slot is out of range, 1 if Key is newly added
+    size_t insert(const Key& key, Value value)
+    {
+        auto slot = KeyToSlot{}(key);
+        if (slot >= m_links.size()) {
+            return 0;
+        }
+        lock_t lock(m_lock);
+        m_values[slot] = std::move(value);
+        if (m_links[slot].newer != absent) {
+            touch(static_cast<uint32_t>(slot));
+            return 0;
+        }
+        if (m_size == m_max_size) {
+            evict();
+        }
+        push_front(static_cast<uint32_t>(slot));
+        m_size++;
+        return 1;
+    }
+
+private:
+    /// \brief The links_t struct   The neighbours of a resident slot in the recency list
+    struct links_t
+    {
+        /// \brief newer            The next more recently used slot, nil for the head, absent if not resident
+        uint32_t newer;
+        /// \brief older            The next less recently used slot, nil for the tail
+        uint32_t older;
+    };
+
+    /// \brief nil                  Marks the ends of the recency list
+    static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max();
+    /// \brief absent               Marks the slots that are not resident
+    static constexpr uint32_t absent = nil - 1;
+
+    /// \brief The lock_t struct    Scoped spinlock
+    struct lock_t
+    {
+        explicit lock_t(std::atomic<uint8_t>& lock)
+            : m_lock(lock)
+        {
+            while (m_lock.exchange(1, std::memory_order_acquire)) {
+                while (m_lock.load(std::memory_order_relaxed)) {
+#if defined(__SSE2__)
+                    _mm_pause();
+#endif
+                }
+            }
+        }
+
+        ~lock_t()
+        {
+            m_lock.store(0, std::memory_order_release);
+        }
+
+        std::atomic<uint8_t>& m_lock;
+    };
+
+    /// \brief evict                Releases the least recently used slot
+    void evict()
+    {
+        auto slot = m_tail;
+        unlink(slot);
+        m_links[slot] = links_t{absent, absent};
+        m_values[slot] = Value{};
+        m_size--;
+    }
+
+    /// \brief unlink               Removes a slot from the recency list
+    void unlink(uint32_t slot)
+    {
+        auto& l = m_links[slot];
+        (l.newer != nil ? m_links[l.newer].older : m_head) = l.older;
+        (l.older != nil ? m_links[l.older].newer : m_tail) = l.newer;
+    }
+
+    /// \brief push_front           Makes a slot the head of the recency list
+    void push_front(uint32_t slot)
+    {
+        m_links[slot].newer = nil;
+        m_links[slot].older = m_head;
+        (m_head != nil ? m_links[m_head].newer : m_tail) = slot;
+        m_head = slot;
+    }
+
+    /// \brief touch                Marks a slot most recently used
+    void touch(uint32_t slot)
+    {
+        if (slot != m_head) {
+            unlink(slot);
+            push_front(slot);
+        }
+    }
+
+    /// \brief m_values             The value of every slot, default-constructed if not resident
+    std::vector<Value> m_values;
+    /// \brief m_links              The recency list links of every slot
+    std::vector<links_t> m_links;
+    /// \brief m_max_size           The maximum amount of resident slots
+    size_t m_max_size;
+    /// \brief m_head               The most recently used slot
+    uint32_t m_head;
+    /// \brief m_tail               The least recently used slot
+    uint32_t m_tail;
+    /// \brief m_size               The amount of resident slots
+    size_t m_size;
+    /// \brief m_lock               Spinlock of the cache
+    mutable std::atomic<uint8_t> m_lock;
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+/// \brief The epoch_pins_t class Epoch-based protection of memory handed out as views, e.g. by BytesCache and
+/// SlabCache. Readers take a pin_t, which records the current epoch, before looking anything up. A writer that
+/// unlinks memory retires it, which starts a new epoch, and reuses it only once it was retired before the
+/// oldest pinned epoch: pins taken after the retirement cannot have found it.
+class epoch_pins_t
+{
+public:
+    /// \brief The pin_t class  Guards the views found after it was taken from reuse, until it is destroyed.
+    ///                         A pin can cover any amount of lookups.
+    class pin_t
+    {
+    public:
+        pin_t(pin_t&& other) noexcept
+            : m_pins(other.m_pins), m_epoch(other.m_epoch)
+        {
+            other.m_pins = nullptr;
+        }
+
+        /// \brief Disable copy constructor
+        pin_t(const pin_t&) = delete;
+        /// \brief Disable copy assignment operator
+        pin_t& operator=(const pin_t&) = delete;
+
+        ~pin_t()
+        {
+            if (m_pins) {
+                m_pins->unpin(m_epoch);
+            }
+        }
+
+    private:
+        friend class epoch_pins_t;
+
+        pin_t(const epoch_pins_t& pins, uint64_t epoch)
+            : m_pins(&pins), m_epoch(epoch)
+        {}
+
+        /// \brief m_pins           The pins the pin was taken from, null once moved from
+        const epoch_pins_t* m_pins;
+        /// \brief m_epoch          The epoch the pin was taken in
+        uint64_t m_epoch;
+    };
+
+    epoch_pins_t()
+        : m_epoch(1)
+    {}
+
+    /// \brief Disable copy constructor
+    epoch_pins_t(const epoch_pins_t&) = delete;
+    /// \brief Disable copy assignment operator
+    epoch_pins_t& operator=(const epoch_pins_t&) = delete;
+
+    /// \brief pin          Pins the current epoch
+    /// \return             The pin, which must not outlive the epoch_pins_t
+    pin_t pin() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pins[m_epoch]++;
+        return pin_t(*this, m_epoch);
+    }
+
+    /// \brief retire       Retires the memory unlinked so far and starts a new epoch. The caller must have
+    ///                     unlinked the memory from everything later lookups can find.
+    /// \return             The epoch the memory was retired in
+    uint64_t retire()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_epoch++;
+    }
+
+    /// \brief oldest       Returns the oldest epoch that pins may still view, memory retired in an earlier
+    ///                     epoch can be reused
+    uint64_t oldest() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pins.empty() ? m_epoch : m_pins.begin()->first;
+    }
+
+private:
+    /// \brief unpin        Releases a pin of an epoch
+    void unpin(uint64_t epoch) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pins.find(epoch);
+        if (--it->second == 0) {
+            m_pins.erase(it);
+        }
+    }
+
+    /// \brief m_mutex      Guards the epoch and the pins
+    mutable std::mutex m_mutex;
+    /// \brief m_epoch      The current epoch
+    uint64_t m_epoch;
+    /// \brief m_pins       The amount of pins of every pinned epoch
+    mutable std::map<uint64_t, size_t> m_pins;
+};
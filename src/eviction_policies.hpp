@@ -0,0 +1,424 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "eviction_policy.hpp"
+#include "hashing.hpp"
+
+/// \brief default_tinylfu_window Default share of the capacity given to the W-TinyLFU admission window
+static constexpr double default_tinylfu_window = 0.01;
+
+/// \brief default_protected_share Default share of the (main) capacity given to the protected SLRU segment
+static constexpr double default_protected_share = 0.8;
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The segmented_lru_t class A set of recency ordered lists (segments) sharing one key index.
+/// Building block of the LRU, SLRU and W-TinyLFU policies. The front of a segment is its most recently
+/// used key, the back its least recently used key.
+class segmented_lru_t
+{
+public:
+    /// \brief segmented_lru_t  Constructor
+    /// \param segments         The amount of segments
+    explicit segmented_lru_t(size_t segments)
+        : m_segments(segments)
+    {}
+
+    /// \brief contains         Indicates whether a key is resident in any segment
+    bool contains(const Key& key) const
+    {
+        return m_index.find(key) != m_index.end();
+    }
+
+    /// \brief segment_of       Returns the segment of a resident key
+    size_t segment_of(const Key& key) const
+    {
+        return m_index.find(key)->second.first;
+    }
+
+    /// \brief push_front       Inserts a key at the front of a segment
+    void push_front(size_t segment, const Key& key)
+    {
+        m_segments[segment].push_front(key);
+        m_index[key] = std::make_pair(segment, m_segments[segment].begin());
+    }
+
+    /// \brief move_to_front    Moves a resident key to the front of a (possibly different) segment
+    void move_to_front(size_t segment, const Key& key)
+    {
+        auto& position = m_index.find(key)->second;
+        m_segments[segment].splice(m_segments[segment].begin(), m_segments[position.first], position.second);
+        position.first = segment;
+    }
+
+    /// \brief erase            Removes a key from its segment
+    void erase(const Key& key)
+    {
+        auto item = m_index.find(key);
+        if (item == m_index.end()) {
+            return;
+        }
+        m_segments[item->second.first].erase(item->second.second);
+        m_index.erase(item);
+    }
+
+    /// \brief back             The least recently used key of a non-empty segment
+    const Key& back(size_t segment) const
+    {
+        return m_segments[segment].back();
+    }
+
+    /// \brief front            The most recently used key of a non-empty segment
+    const Key& front(size_t segment) const
+    {
+        return m_segments[segment].front();
+    }
+
+    /// \brief size             The amount of keys in a segment
+    size_t size(size_t segment) const
+    {
+        return m_segments[segment].size();
+    }
+
+    /// \brief resident         All keys, least recently used segment and key first
+    std::vector<Key> resident() const
+    {
+        std::vector<Key> keys;
+        keys.reserve(m_index.size());
+        for (auto& segment : m_segments) {
+            keys.insert(keys.end(), segment.rbegin(), segment.rend());
+        }
+        return keys;
+    }
+
+private:
+    using position_t = std::pair<size_t, typename std::list<Key>::iterator>;
+
+    /// \brief m_segments       The recency ordered segments
+    std::vector<std::list<Key>> m_segments;
+    /// \brief m_index          The Key->(segment, position) hashmap
+    std::unordered_map<Key, position_t, HashFunction, KeyEqual> m_index;
+};
+
+/// \brief The frequency_sketch_t class Count-min sketch of 8-bit counters estimating access frequencies.
+/// All counters are halved once the amount of recorded accesses reaches ten times the tracked capacity,
+/// so that the sketch follows changes in popularity.
+class frequency_sketch_t
+{
+public:
+    /// \brief frequency_sketch_t   Constructor
+    /// \param capacity             The amount of keys the cache can hold
+    explicit frequency_sketch_t(size_t capacity)
+        : m_additions(0),
+          m_sample_size(10 * std::max<size_t>(capacity, 16))
+    {
+        size_t width = 16;
+        while (width < capacity) {
+            width <<= 1;
+        }
+        m_mask = width - 1;
+        m_table.assign(depth * width, 0);
+    }
+
+    /// \brief increment            Records an access of a hash value
+    void increment(uint64_t hash)
+    {
+        for (size_t row = 0; row < depth; row++) {
+            auto& counter = m_table[row * (m_mask + 1) + index(hash, row)];
+            if (counter < 255) {
+                counter++;
+            }
+        }
+        if (++m_additions == m_sample_size) {
+            for (auto& counter : m_table) {
+                counter >>= 1;
+            }
+            m_additions /= 2;
+        }
+    }
+
+    /// \brief frequency            Estimates the access frequency of a hash value
+    uint8_t frequency(uint64_t hash) const
+    {
+        uint8_t estimate = 255;
+        for (size_t row = 0; row < depth; row++) {
+            estimate = std::min(estimate, m_table[row * (m_mask + 1) + index(hash, row)]);
+        }
+        return estimate;
+    }
+
+private:
+    /// \brief depth                The amount of rows
+    static const size_t depth = 4;
+
+    size_t index(uint64_t hash, size_t row) const
+    {
+        return mix_hash(hash + row * 0x9e3779b97f4a7c15ull) & m_mask;
+    }
+
+    /// \brief m_table              The counters, row after row
+    std::vector<uint8_t> m_table;
+    /// \brief m_mask               Width of a row minus one
+    size_t m_mask;
+    /// \brief m_additions          Accesses recorded since the last halving
+    size_t m_additions;
+    /// \brief m_sample_size        Accesses between two halvings
+    size_t m_sample_size;
+};
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The lru_policy_t class Evicts the least recently used key
+class lru_policy_t : public eviction_policy_t<Key>
+{
+public:
+    lru_policy_t()
+        : m_lru(1)
+    {}
+
+    void on_insert(const Key& key, size_t) override { m_lru.push_front(0, key); }
+    void on_access(const Key& key) override { m_lru.move_to_front(0, key); }
+    void on_erase(const Key& key) override { m_lru.erase(key); }
+    Key victim() override { return m_lru.back(0); }
+    std::vector<Key> resident() const override { return m_lru.resident(); }
+
+private:
+    /// \brief m_lru                The recency list
+    segmented_lru_t<Key, HashFunction, KeyEqual> m_lru;
+};
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The lfu_policy_t class Evicts the least frequently used key, the least recent one among ties
+class lfu_policy_t : public eviction_policy_t<Key>
+{
+public:
+    lfu_policy_t()
+        : m_clock(0)
+    {}
+
+    void on_insert(const Key& key, size_t) override
+    {
+        auto rank = std::make_pair(size_t(1), ++m_clock);
+        m_order[rank] = key;
+        m_ranks[key] = rank;
+    }
+
+    void on_access(const Key& key) override
+    {
+        auto item = m_ranks.find(key);
+        m_order.erase(item->second);
+        item->second = std::make_pair(item->second.first + 1, ++m_clock);
+        m_order[item->second] = key;
+    }
+
+    void on_erase(const Key& key) override
+    {
+        auto item = m_ranks.find(key);
+        if (item == m_ranks.end()) {
+            return;
+        }
+        m_order.erase(item->second);
+        m_ranks.erase(item);
+    }
+
+    Key victim() override { return m_order.begin()->second; }
+
+    std::vector<Key> resident() const override
+    {
+        std::vector<Key> keys;
+        keys.reserve(m_order.size());
+        for (auto& o : m_order) {
+            keys.push_back(o.second);
+        }
+        return keys;
+    }
+
+private:
+    using rank_t = std::pair<size_t, uint64_t>;
+
+    /// \brief m_order              The (frequency, last access)->Key ordered map
+    std::map<rank_t, Key> m_order;
+    /// \brief m_ranks              The Key->(frequency, last access) hashmap
+    std::unordered_map<Key, rank_t, HashFunction, KeyEqual> m_ranks;
+    /// \brief m_clock              Logical clock, breaks frequency ties by recency
+    uint64_t m_clock;
+};
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The slru_policy_t class Segmented LRU. New keys enter a probation segment and are promoted
+/// to a protected segment when accessed again. Victims are taken from the probation segment first.
+class slru_policy_t : public eviction_policy_t<Key>
+{
+public:
+    /// \brief slru_policy_t        Constructor
+    /// \param capacity             The maximum capacity of the cache
+    explicit slru_policy_t(size_t capacity)
+        : m_lru(2),
+          m_protected_capacity(std::max<size_t>(1, capacity * default_protected_share))
+    {}
+
+    void on_insert(const Key& key, size_t) override { m_lru.push_front(probation, key); }
+
+    void on_access(const Key& key) override
+    {
+        m_lru.move_to_front(protect, key);
+        if (m_lru.size(protect) > m_protected_capacity) {
+            m_lru.move_to_front(probation, m_lru.back(protect));
+        }
+    }
+
+    void on_erase(const Key& key) override { m_lru.erase(key); }
+
+    Key victim() override
+    {
+        return m_lru.size(probation) ? m_lru.back(probation) : m_lru.back(protect);
+    }
+
+    std::vector<Key> resident() const override { return m_lru.resident(); }
+
+private:
+    static const size_t probation = 0;
+    static const size_t protect = 1;
+
+    /// \brief m_lru                The probation and protected segments
+    segmented_lru_t<Key, HashFunction, KeyEqual> m_lru;
+    /// \brief m_protected_capacity The maximum size of the protected segment
+    size_t m_protected_capacity;
+};
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The tinylfu_policy_t class W-TinyLFU. New keys enter a small LRU admission window; keys leaving
+/// the window become candidates of a main SLRU and are only admitted over the main victim if the
+/// frequency sketch estimates them to be more popular.
+class tinylfu_policy_t : public eviction_policy_t<Key>
+{
+public:
+    /// \brief tinylfu_policy_t     Constructor
+    /// \param capacity             The maximum capacity of the cache
+    /// \param window               The share of the capacity given to the admission window
+    explicit tinylfu_policy_t(size_t capacity, double window = default_tinylfu_window)
+        : m_lru(3),
+          m_sketch(capacity),
+          m_capacity(std::max<size_t>(capacity, 1)),
+          m_has_candidate(false)
+    {
+        set_window(window);
+    }
+
+    /// \brief set_window           Resizes the admission window, segments adapt lazily
+    /// \param window               The share of the capacity given to the admission window
+    void set_window(double window)
+    {
+        m_window = std::min(std::max(window, 0.0), 1.0);
+        m_window_capacity = std::max<size_t>(1, m_capacity * m_window);
+        m_protected_capacity = std::max<size_t>(1, (m_capacity - std::min(m_capacity, m_window_capacity))
+                                                   * default_protected_share);
+    }
+
+    /// \brief window               The share of the capacity given to the admission window
+    double window() const { return m_window; }
+
+    void on_insert(const Key& key, size_t) override
+    {
+        m_sketch.increment(HashFunction{}(key));
+        m_lru.push_front(window_segment, key);
+        if (m_lru.size(window_segment) > m_window_capacity) {
+            // the window's LRU key becomes the admission candidate of the main segments
+            m_candidate = m_lru.back(window_segment);
+            m_has_candidate = true;
+            m_lru.move_to_front(probation, m_candidate);
+        }
+    }
+
+    void on_access(const Key& key) override
+    {
+        m_sketch.increment(HashFunction{}(key));
+        if (m_lru.segment_of(key) == window_segment) {
+            m_lru.move_to_front(window_segment, key);
+            return;
+        }
+        if (m_has_candidate && KeyEqual{}(key, m_candidate)) {
+            m_has_candidate = false;
+        }
+        m_lru.move_to_front(protect, key);
+        if (m_lru.size(protect) > m_protected_capacity) {
+            m_lru.move_to_front(probation, m_lru.back(protect));
+        }
+    }
+
+    void on_miss(const Key& key) override
+    {
+        m_sketch.increment(HashFunction{}(key));
+    }
+
+    void on_erase(const Key& key) override
+    {
+        if (m_has_candidate && KeyEqual{}(key, m_candidate)) {
+            m_has_candidate = false;
+        }
+        m_lru.erase(key);
+    }
+
+    Key victim() override
+    {
+        if (m_lru.size(probation) + m_lru.size(protect) == 0) {
+            return m_lru.back(window_segment);
+        }
+        auto& main_victim = m_lru.size(probation) ? m_lru.back(probation) : m_lru.back(protect);
+        if (!m_has_candidate || KeyEqual{}(main_victim, m_candidate)) {
+            return main_victim;
+        }
+        // admission duel between the latest window evictee and the main victim
+        auto candidate_frequency = m_sketch.frequency(HashFunction{}(m_candidate));
+        auto victim_frequency = m_sketch.frequency(HashFunction{}(main_victim));
+        return candidate_frequency > victim_frequency ? main_victim : m_candidate;
+    }
+
+    std::vector<Key> resident() const override { return m_lru.resident(); }
+
+private:
+    static const size_t window_segment = 0;
+    static const size_t probation = 1;
+    static const size_t protect = 2;
+
+    /// \brief m_lru                The window, probation and protected segments
+    segmented_lru_t<Key, HashFunction, KeyEqual> m_lru;
+    /// \brief m_sketch             Access frequency estimator
+    frequency_sketch_t m_sketch;
+    /// \brief m_capacity           The maximum capacity of the cache
+    size_t m_capacity;
+    /// \brief m_window             The share of the capacity given to the admission window
+    double m_window;
+    /// \brief m_window_capacity    The maximum size of the admission window
+    size_t m_window_capacity;
+    /// \brief m_protected_capacity The maximum size of the protected segment
+    size_t m_protected_capacity;
+    /// \brief m_candidate          The latest key moved from the window to the probation segment
+    Key m_candidate;
+    /// \brief m_has_candidate      Whether m_candidate is still an unaccessed probation key
+    bool m_has_candidate;
+};
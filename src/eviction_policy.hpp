@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+template<class Key>
+/// \brief The eviction_policy_t struct Interface of a pluggable eviction policy.
+/// A policy is notified about every change of the resident key set and is asked to pick a victim when
+/// the cache reaches its maximum capacity. All calls are made while the cache holds its mutex, so a
+/// policy does not need any synchronization of its own.
+struct eviction_policy_t
+{
+    /// \brief Virtual destructor
+    virtual ~eviction_policy_t() = default;
+
+    /// \brief on_insert                    Notifies the policy that a key became resident
+    /// \param key                          The key
+    /// \param weight                       The weight of the inserted entry
+    virtual void on_insert(const Key& key, size_t weight) = 0;
+
+    /// \brief on_access                    Notifies the policy that a resident key was looked up or re-inserted
+    /// \param key                          The key
+    virtual void on_access(const Key& key) = 0;
+
+    /// \brief on_miss                      Notifies the policy that a non-resident key was looked up
+    /// \param key                          The key
+    virtual void on_miss(const Key&) {}
+
+    /// \brief on_erase                     Notifies the policy that a key is no longer resident
+    /// \param key                          The key
+    virtual void on_erase(const Key& key) = 0;
+
+    /// \brief victim                       Selects the key that should be evicted next.
+    ///                                     Only called while at least one key is resident.
+    /// \return                             The key to evict
+    virtual Key victim() = 0;
+
+    /// \brief resident                     Lists the resident keys, the best eviction candidates first.
+    ///                                     Used to hand the resident set over to another policy.
+    /// \return                             The resident keys
+    virtual std::vector<Key> resident() const = 0;
+
+    /// \brief maintenance                  Periodic housekeeping (e.g. training), called off the lookup path
+    virtual void maintenance() {}
+};
@@ -0,0 +1,249 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CACHE_HASH_DISPATCH 1
+#endif
+
+/// \brief mix_hash Finalizer of MurmurHash3, spreads the bits of a (possibly weak) hash value
+/// \param h        The hash value
+/// \return         The mixed hash value
+constexpr uint64_t mix_hash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/// \brief mix_hash_batch_scalar    mix_hash of every word of a batch, one word at a time
+/// \param words                    The words
+/// \param count                    The amount of words
+/// \param hashes                   Receives the hashes, may alias words
+inline void mix_hash_batch_scalar(const uint64_t* words, size_t count, uint64_t* hashes)
+{
+    for (size_t i = 0; i < count; i++) {
+        hashes[i] = mix_hash(words[i]);
+    }
+}
+
+#if defined(CACHE_HASH_DISPATCH)
+/// \brief mul64_avx2               Low 64 bits of four 64-bit products; AVX2 only multiplies 32-bit halves
+__attribute__((target("avx2"))) inline __m256i mul64_avx2(__m256i a, __m256i b)
+{
+    auto low = _mm256_mul_epu32(a, b);
+    auto cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                  _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+/// \brief mix_hash_avx2            mix_hash of four words
+__attribute__((target("avx2"))) inline __m256i mix_hash_avx2(__m256i h)
+{
+    h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+    h = mul64_avx2(h, _mm256_set1_epi64x(static_cast<long long>(0xff51afd7ed558ccdull)));
+    h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+    h = mul64_avx2(h, _mm256_set1_epi64x(static_cast<long long>(0xc4ceb9fe1a85ec53ull)));
+    return _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+}
+
+/// \brief mix_hash_batch_avx2      mix_hash_batch_scalar, eight words (two independent vectors) at a time
+__attribute__((target("avx2"))) inline void mix_hash_batch_avx2(const uint64_t* words, size_t count,
+                                                                uint64_t* hashes)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i + 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), mix_hash_avx2(a));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i + 4), mix_hash_avx2(b));
+    }
+    for (; i + 4 <= count; i += 4) {
+        auto h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), mix_hash_avx2(h));
+    }
+    mix_hash_batch_scalar(words + i, count - i, hashes + i);
+}
+
+/// \brief shift33_avx512           Eight words shifted right by 33 bits. The zero-masked form passes a zeroed
+///                                 operand, where _mm512_srli_epi64 passes an undefined one that GCC 12 reports
+///                                 as maybe uninitialized.
+__attribute__((target("avx512f"))) inline __m512i shift33_avx512(__m512i h)
+{
+    return _mm512_maskz_srli_epi64(0xff, h, 33);
+}
+
+/// \brief mix_hash_avx512          mix_hash of eight words
+__attribute__((target("avx512f,avx512dq"))) inline __m512i mix_hash_avx512(__m512i h)
+{
+    h = _mm512_xor_si512(h, shift33_avx512(h));
+    h = _mm512_mullo_epi64(h, _mm512_set1_epi64(static_cast<long long>(0xff51afd7ed558ccdull)));
+    h = _mm512_xor_si512(h, shift33_avx512(h));
+    h = _mm512_mullo_epi64(h, _mm512_set1_epi64(static_cast<long long>(0xc4ceb9fe1a85ec53ull)));
+    return _mm512_xor_si512(h, shift33_avx512(h));
+}
+
+/// \brief mix_hash_batch_avx512    mix_hash_batch_scalar, sixteen words (two independent vectors) at a time
+__attribute__((target("avx512f,avx512dq"))) inline void mix_hash_batch_avx512(const uint64_t* words, size_t count,
+                                                                              uint64_t* hashes)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        auto a = _mm512_loadu_si512(words + i);
+        auto b = _mm512_loadu_si512(words + i + 8);
+        _mm512_storeu_si512(hashes + i, mix_hash_avx512(a));
+        _mm512_storeu_si512(hashes + i + 8, mix_hash_avx512(b));
+    }
+    for (; i + 8 <= count; i += 8) {
+        _mm512_storeu_si512(hashes + i, mix_hash_avx512(_mm512_loadu_si512(words + i)));
+    }
+    mix_hash_batch_scalar(words + i, count - i, hashes + i);
+}
+#endif
+
+/// \brief mix_hash_batch           mix_hash of every word of a batch, with the widest kernel the CPU supports
+///                                 (AVX-512, AVX2 or scalar), chosen once at runtime
+/// \param words                    The words
+/// \param count                    The amount of words
+/// \param hashes                   Receives the hashes, may alias words
+inline void mix_hash_batch(const uint64_t* words, size_t count, uint64_t* hashes)
+{
+#if defined(CACHE_HASH_DISPATCH)
+    using kernel_t = void (*)(const uint64_t*, size_t, uint64_t*);
+    static const kernel_t kernel = []() -> kernel_t {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+            return mix_hash_batch_avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return mix_hash_batch_avx2;
+        }
+        return mix_hash_batch_scalar;
+    }();
+    kernel(words, count, hashes);
+#else
+    mix_hash_batch_scalar(words, count, hashes);
+#endif
+}
+
+/// \brief The fixed_width_hash struct Hash function for trivially copyable keys of at most 8 bytes (integers,
+/// packed symbol/date keys, ...): mix_hash of the bytes of the key. Batches of keys are hashed with
+/// mix_hash_batch, see has_hash_batch.
+struct fixed_width_hash
+{
+    template<class T>
+    size_t operator() (const T& key) const
+    {
+        return static_cast<size_t>(mix_hash(to_word(key)));
+    }
+
+    /// \brief hash_batch       The hashes of a batch of keys, equal to those of operator()
+    template<class T>
+    static void hash_batch(const T* keys, size_t count, uint64_t* hashes)
+    {
+        for (size_t i = 0; i < count; i++) {
+            hashes[i] = to_word(keys[i]);
+        }
+        mix_hash_batch(hashes, count, hashes);
+    }
+
+private:
+    /// \brief to_word          The bytes of a key, zero-extended to a word
+    template<class T>
+    static uint64_t to_word(const T& key)
+    {
+        static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(uint64_t),
+                      "fixed_width_hash requires trivially copyable keys of at most 8 bytes");
+        uint64_t word = 0;
+        std::memcpy(&word, &key, sizeof(T));
+        return word;
+    }
+};
+
+/// \brief The has_hash_batch struct Whether a hash function hashes batches of keys via a static hash_batch
+template<class Hash, class Key, class = void>
+struct has_hash_batch : std::false_type {};
+
+template<class Hash, class Key>
+struct has_hash_batch<Hash, Key, decltype(Hash::hash_batch(std::declval<const Key*>(), size_t(),
+                                                           std::declval<uint64_t*>()))> : std::true_type {};
+
+/// \brief hash_combine Combines a hash value into a seed, wyhash-style (folded 128-bit product). Unlike XOR,
+/// the result depends on the order of the combined values, and equal values do not cancel out.
+/// \param seed         The hash of the previous values
+/// \param value        The hash of the next value
+/// \return             The combined hash value
+inline uint64_t hash_combine(uint64_t seed, uint64_t value)
+{
+    auto product = static_cast<unsigned __int128>(seed ^ 0xa0761d6478bd642full) * (value ^ 0xe7037ed1a0b428dbull);
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+/// \brief The hashed_key_t struct A Key together with its hash value, computed once and reused by every hashmap
+/// the Key is stored in. A probe refers to a Key owned by the caller instead, so that lookups do not copy it.
+template<class Key>
+struct hashed_key_t
+{
+    hashed_key_t()
+        : hash(0), view(nullptr)
+    {}
+
+    /// \brief hashed_key_t     Owning constructor
+    hashed_key_t(Key k, uint64_t h)
+        : key(std::move(k)), hash(h), view(nullptr)
+    {}
+
+    /// \brief probe            A non-owning hashed key, valid as long as the referred Key
+    static hashed_key_t probe(const Key& k, uint64_t h)
+    {
+        hashed_key_t hashed;
+        hashed.hash = h;
+        hashed.view = &k;
+        return hashed;
+    }
+
+    /// \brief get              The Key
+    const Key& get() const
+    {
+        return view ? *view : key;
+    }
+
+    /// \brief owned            An owning copy, to be stored
+    hashed_key_t owned() const
+    {
+        return hashed_key_t(get(), hash);
+    }
+
+    /// \brief key              The Key, if owning
+    Key key;
+    /// \brief hash             The hash value of the Key
+    uint64_t hash;
+    /// \brief view             The referred Key, if a probe
+    const Key* view;
+};
+
+/// \brief The stored_hash struct Hash function of hashed_key_t, returns the stored hash value
+struct stored_hash
+{
+    template<class Key>
+    size_t operator() (const hashed_key_t<Key>& key) const
+    {
+        return static_cast<size_t>(key.hash);
+    }
+};
+
+/// \brief The hashed_key_equal struct Equality of hashed_key_t, compares the hash values before the keys
+template<class KeyEqual>
+struct hashed_key_equal
+{
+    template<class Key>
+    bool operator() (const hashed_key_t<Key>& a, const hashed_key_t<Key>& b) const
+    {
+        return a.hash == b.hash && KeyEqual{}(a.get(), b.get());
+    }
+};
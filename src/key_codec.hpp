@@ -0,0 +1,326 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// A key codec converts the Keys of a Cache to the form the Cache stores, hashes and compares, and back:
+///     using encoded_type = ...;
+///     static encoded_type encode(const Key& key);     // may return a reference to the key
+///     static Key decode(const encoded_type& encoded); // may return a reference to the encoded key
+/// Interning codecs (see has_key_interning) encode Keys into references to shared, reference-counted storage:
+///     static encoded_type intern(const Key& key);     // interns the Key, the result holds one reference
+///     static void retain(const encoded_type& encoded);
+///     static void release(const encoded_type& encoded);
+/// Their encode only looks the Key up, and returns a form that matches no stored Key if it is not interned.
+
+template<class Key>
+/// \brief The identity_key_codec struct Default key codec, Keys are stored as they are
+struct identity_key_codec
+{
+    using encoded_type = Key;
+
+    static const Key& encode(const Key& key)
+    {
+        return key;
+    }
+
+    static const Key& decode(const Key& key)
+    {
+        return key;
+    }
+};
+
+/// \brief The symbol_date_codec struct Packs (symbol, date) keys, e.g. {"BTCUSD", "2019-01-05"}, into a single
+/// 64-bit integer: up to 7 symbol characters of 6 bits each (A-Z, 0-9, '.', '-', '_', '/') in the upper 42
+/// bits and the date as a day number since 1970-01-01 in the lower 22 bits. Keys that do not fit are rejected
+/// with std::invalid_argument. Encoded keys of the same symbol are ordered by date.
+struct symbol_date_codec
+{
+    using key_type = std::pair<std::string, std::string>;
+    using encoded_type = uint64_t;
+
+    static encoded_type encode(const key_type& key)
+    {
+        if (key.first.size() > max_symbol_length) {
+            throw std::invalid_argument("symbol longer than 7 characters: " + key.first);
+        }
+        uint64_t symbol = 0;
+        for (size_t i = 0; i < max_symbol_length; i++) {
+            symbol = (symbol << char_bits) | (i < key.first.size() ? char_code(key.first[i]) : 0);
+        }
+        return (symbol << day_bits) | day_number(key.second);
+    }
+
+    static key_type decode(encoded_type encoded)
+    {
+        key_type key;
+        auto symbol = encoded >> day_bits;
+        for (size_t i = 0; i < max_symbol_length; i++) {
+            auto code = (symbol >> (char_bits * (max_symbol_length - 1 - i))) & ((1u << char_bits) - 1);
+            if (code == 0) {
+                break;
+            }
+            key.first += alphabet[code - 1];
+        }
+        key.second = date(static_cast<int64_t>(encoded & ((uint64_t(1) << day_bits) - 1)));
+        return key;
+    }
+
+private:
+    static constexpr size_t char_bits = 6;
+    static constexpr size_t day_bits = 22;
+    static constexpr size_t max_symbol_length = (64 - day_bits) / char_bits;
+    static constexpr const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789.-_/";
+
+    /// \brief char_code        The non-zero code of a symbol character, 0 marks the end of the symbol
+    static uint64_t char_code(char c)
+    {
+        for (uint64_t code = 0; alphabet[code]; code++) {
+            if (alphabet[code] == c) {
+                return code + 1;
+            }
+        }
+        throw std::invalid_argument(std::string("unsupported symbol character: ") + c);
+    }
+
+    /// \brief day_number       The days since 1970-01-01 of a YYYY-MM-DD date
+    static uint64_t day_number(const std::string& date)
+    {
+        auto digits = [&date](size_t from, size_t count) {
+            int64_t n = 0;
+            for (size_t i = from; i < from + count; i++) {
+                if (date[i] < '0' || date[i] > '9') {
+                    throw std::invalid_argument("malformed date: " + date);
+                }
+                n = n * 10 + (date[i] - '0');
+            }
+            return n;
+        };
+        if (date.size() != 10 || date[4] != '-' || date[7] != '-') {
+            throw std::invalid_argument("malformed date: " + date);
+        }
+        auto y = digits(0, 4);
+        auto m = digits(5, 2);
+        auto d = digits(8, 2);
+        if (m < 1 || m > 12 || d < 1 || d > days_in_month(y, m)) {
+            throw std::invalid_argument("invalid date: " + date);
+        }
+
+        // days_from_civil, proleptic Gregorian calendar
+        y -= m <= 2;
+        auto era = y / 400;
+        auto yoe = y - era * 400;
+        auto doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        auto days = era * 146097 + doe - 719468;
+        if (days < 0 || days >= (int64_t(1) << day_bits)) {
+            throw std::invalid_argument("date out of range: " + date);
+        }
+        return static_cast<uint64_t>(days);
+    }
+
+    /// \brief date             The YYYY-MM-DD date of a day number, the inverse of day_number
+    static std::string date(int64_t days)
+    {
+        // civil_from_days
+        days += 719468;
+        auto era = days / 146097;
+        auto doe = days - era * 146097;
+        auto yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        auto doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        auto mp = (5 * doy + 2) / 153;
+        auto d = doy - (153 * mp + 2) / 5 + 1;
+        auto m = mp < 10 ? mp + 3 : mp - 9;
+        auto y = yoe + era * 400 + (m <= 2);
+
+        std::string result = "0000-00-00";
+        for (size_t i = 0; i < 4; i++, y /= 10) {
+            result[3 - i] = static_cast<char>('0' + y % 10);
+        }
+        result[5] = static_cast<char>('0' + m / 10);
+        result[6] = static_cast<char>('0' + m % 10);
+        result[8] = static_cast<char>('0' + d / 10);
+        result[9] = static_cast<char>('0' + d % 10);
+        return result;
+    }
+
+    static int64_t days_in_month(int64_t y, int64_t m)
+    {
+        static const int64_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        auto leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+        return m == 2 && leap ? 29 : days[m - 1];
+    }
+};
+
+/// \brief The has_key_interning struct Whether a key codec interns Keys, i.e. has intern, retain and release
+template<class Codec, class = void>
+struct has_key_interning : std::false_type {};
+
+template<class Codec>
+struct has_key_interning<Codec, decltype(Codec::release(std::declval<const typename Codec::encoded_type&>()))>
+        : std::true_type {};
+
+/// \brief The string_intern_pool_t class Stores every distinct string once and refers to it by a 32-bit id.
+/// Ids are reference counted; the string of an id is freed once its last reference is released, and the id is
+/// reused. Id 0 (none) refers to no string. All members are thread safe.
+class string_intern_pool_t
+{
+public:
+    /// \brief none             The id of no string
+    static const uint32_t none = 0;
+
+    string_intern_pool_t() = default;
+    /// \brief Disable copy constructor
+    string_intern_pool_t(const string_intern_pool_t&) = delete;
+    /// \brief Disable copy assignment operator
+    string_intern_pool_t& operator=(const string_intern_pool_t&) = delete;
+
+    /// \brief find             The id of an interned string, none if it is not interned
+    uint32_t find(std::string_view s) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto id = m_ids.find(s);
+        return id != m_ids.end() ? id->second : none;
+    }
+
+    /// \brief intern           Interns a string
+    /// \return                 Its id, holding one reference
+    uint32_t intern(std::string_view s)
+    {
+        std::lock_guard<std::shared_mutex> lock(m_mutex);
+        auto found = m_ids.find(s);
+        if (found != m_ids.end()) {
+            m_slots[found->second - 1].references++;
+            return found->second;
+        }
+        uint32_t id;
+        if (!m_free.empty()) {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+        else {
+            if (m_slots.size() == std::numeric_limits<uint32_t>::max()) {
+                throw std::length_error("string_intern_pool_t ran out of ids");
+            }
+            m_slots.emplace_back();
+            id = static_cast<uint32_t>(m_slots.size());
+        }
+        auto& slot = m_slots[id - 1];
+        slot.value.assign(s.data(), s.size());
+        slot.references = 1;
+        m_ids.emplace(slot.value, id);
+        return id;
+    }
+
+    /// \brief retain           Adds a reference to an id
+    void retain(uint32_t id)
+    {
+        std::lock_guard<std::shared_mutex> lock(m_mutex);
+        m_slots[id - 1].references++;
+    }
+
+    /// \brief release          Drops a reference to an id, freeing its string with the last one
+    void release(uint32_t id)
+    {
+        std::lock_guard<std::shared_mutex> lock(m_mutex);
+        auto& slot = m_slots[id - 1];
+        if (--slot.references == 0) {
+            m_ids.erase(slot.value);
+            slot.value = std::string();
+            m_free.push_back(id);
+        }
+    }
+
+    /// \brief get              The string of a referenced id
+    std::string get(uint32_t id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_slots[id - 1].value;
+    }
+
+    /// \brief size             The amount of interned strings
+    size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_ids.size();
+    }
+
+private:
+    /// \brief The slot_t struct    An interned string
+    struct slot_t
+    {
+        std::string value;
+        uint32_t references = 0;
+    };
+
+    /// \brief m_slots          The strings, by id - 1. A deque, so that the keys of m_ids stay valid.
+    std::deque<slot_t> m_slots;
+    /// \brief m_free           The ids of freed slots
+    std::vector<uint32_t> m_free;
+    /// \brief m_ids            The ids of the interned strings, viewing the strings of m_slots
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+    /// \brief m_mutex          Guards the pool, shared by lookups
+    mutable std::shared_mutex m_mutex;
+};
+
+template<class Tag = void>
+/// \brief The interned_pair_codec struct Interning codec of pair<string, string> keys, e.g. {"BTCUSD",
+/// "2019-01-05"}: both strings are interned in a pool shared by all caches of the same Tag, and the key is
+/// stored as the two 32-bit ids packed into a 64-bit integer. A string shared by many keys is stored once, and
+/// freed once no cached or loading key refers to it any more.
+struct interned_pair_codec
+{
+    using key_type = std::pair<std::string, std::string>;
+    using encoded_type = uint64_t;
+
+    static encoded_type encode(const key_type& key)
+    {
+        return pack(pool().find(key.first), pool().find(key.second));
+    }
+
+    static encoded_type intern(const key_type& key)
+    {
+        auto first = pool().intern(key.first);
+        return pack(first, pool().intern(key.second));
+    }
+
+    static void retain(encoded_type encoded)
+    {
+        pool().retain(static_cast<uint32_t>(encoded >> 32));
+        pool().retain(static_cast<uint32_t>(encoded));
+    }
+
+    static void release(encoded_type encoded)
+    {
+        pool().release(static_cast<uint32_t>(encoded >> 32));
+        pool().release(static_cast<uint32_t>(encoded));
+    }
+
+    static key_type decode(encoded_type encoded)
+    {
+        return key_type(pool().get(static_cast<uint32_t>(encoded >> 32)), pool().get(static_cast<uint32_t>(encoded)));
+    }
+
+    /// \brief pool             The pool of the interned strings. It is never destroyed, so that caches with
+    ///                         static storage duration can release their keys on destruction.
+    static string_intern_pool_t& pool()
+    {
+        static auto* pool = new string_intern_pool_t();
+        return *pool;
+    }
+
+private:
+    static encoded_type pack(uint32_t first, uint32_t second)
+    {
+        return (static_cast<uint64_t>(first) << 32) | second;
+    }
+};
@@ -0,0 +1,250 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "eviction_policy.hpp"
+
+/// \brief default_learned_candidates Default amount of entries sampled per eviction
+static const size_t default_learned_candidates = 8;
+
+/// \brief default_learned_samples Default maximum amount of training samples kept between trainings
+static const size_t default_learned_samples = 4096;
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The learned_eviction_policy_t class Experimental eviction policy driven by an online model.
+/// Every resident key keeps a few access features (the two most recent inter-arrival deltas, its age,
+/// its weight and its hit count). A linear model predicts the logarithm of the time until the next
+/// access from these features and is trained with SGD from observed re-accesses on the maintenance path.
+/// On eviction a few resident entries are sampled and the one with the farthest predicted next access
+/// is evicted. Time is measured in logical ticks (one tick per insertion/access), so the policy is
+/// independent of the wall clock and runs on CPU only.
+/// An untrained model predicts no reuse information at all, in which case the policy behaves like a
+/// sampled LRU.
+class learned_eviction_policy_t : public eviction_policy_t<Key>
+{
+public:
+    /// \brief learned_eviction_policy_t    Constructor
+    /// \param candidates                   The amount of entries sampled per eviction
+    /// \param max_samples                  The maximum amount of training samples kept between trainings
+    /// \param seed                         Seed of the candidate sampler
+    learned_eviction_policy_t(
+            size_t candidates = default_learned_candidates,
+            size_t max_samples = default_learned_samples,
+            uint64_t seed = 0x9e3779b97f4a7c15ull)
+        : m_candidates(candidates ? candidates : 1),
+          m_max_samples(max_samples),
+          m_clock(0),
+          m_rng(seed)
+    {
+        m_weights.fill(0.f);
+    }
+
+    void on_insert(const Key& key, size_t weight) override
+    {
+        m_clock++;
+        entry_t entry{key, m_clock, m_clock, 0, 0, weight, 0, {}};
+        entry.snapshot = features(entry);
+        m_index[key] = m_entries.size();
+        m_entries.push_back(std::move(entry));
+    }
+
+    void on_access(const Key& key) override
+    {
+        auto item = m_index.find(key);
+        if (item == m_index.end()) {
+            return;
+        }
+        m_clock++;
+        auto& entry = m_entries[item->second];
+        auto delta = m_clock - entry.last_access;
+
+        // The time that passed since the previous access is the label of the snapshot taken back then
+        add_sample(entry.snapshot, std::log1p(static_cast<float>(delta)));
+
+        entry.previous_delta = entry.last_delta;
+        entry.last_delta = delta;
+        entry.last_access = m_clock;
+        entry.hits++;
+        entry.snapshot = features(entry);
+    }
+
+    void on_erase(const Key& key) override
+    {
+        auto item = m_index.find(key);
+        if (item == m_index.end()) {
+            return;
+        }
+        auto position = item->second;
+        m_index.erase(item);
+        if (position != m_entries.size() - 1) {
+            m_entries[position] = std::move(m_entries.back());
+            m_index[m_entries[position].key] = position;
+        }
+        m_entries.pop_back();
+    }
+
+    Key victim() override
+    {
+        std::uniform_int_distribution<size_t> pick(0, m_entries.size() - 1);
+        size_t victim_position = pick(m_rng);
+        float victim_score = score(m_entries[victim_position]);
+        for (size_t i = 1; i < m_candidates; i++) {
+            auto position = pick(m_rng);
+            auto candidate_score = score(m_entries[position]);
+            if (candidate_score > victim_score) {
+                victim_position = position;
+                victim_score = candidate_score;
+            }
+        }
+
+        // The evicted entry was not re-accessed for a while; teach the model that its features mean
+        // "far away" with a label well past the time it already waited.
+        auto& victim = m_entries[victim_position];
+        add_sample(victim.snapshot, std::log1p(4.f * static_cast<float>(m_clock - victim.last_access + 1)));
+        return victim.key;
+    }
+
+    std::vector<Key> resident() const override
+    {
+        std::vector<const entry_t*> entries;
+        entries.reserve(m_entries.size());
+        for (auto& entry : m_entries) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(),
+                [](const entry_t* a, const entry_t* b) {
+                    return a->last_access < b->last_access;
+                });
+        std::vector<Key> keys;
+        keys.reserve(entries.size());
+        for (auto entry : entries) {
+            keys.push_back(entry->key);
+        }
+        return keys;
+    }
+
+    /// \brief maintenance                  Trains the model on the samples gathered since the last call
+    void maintenance() override
+    {
+        for (size_t epoch = 0; epoch < training_epochs; epoch++) {
+            for (auto& sample : m_samples) {
+                auto error = predict(sample.features) - sample.label;
+                float norm = 1.f;
+                for (auto f : sample.features) {
+                    norm += f * f;
+                }
+                // Normalized LMS step, stable regardless of the feature scale
+                for (size_t i = 0; i < feature_count; i++) {
+                    m_weights[i] -= learning_rate * error * sample.features[i] / norm;
+                }
+            }
+        }
+        m_samples.clear();
+    }
+
+private:
+    /// \brief feature_count                Bias, two inter-arrival deltas, age, weight and hits
+    static const size_t feature_count = 6;
+    /// \brief training_epochs              Passes over the gathered samples per maintenance
+    static const size_t training_epochs = 2;
+    /// \brief learning_rate                Step of the normalized LMS update
+    static constexpr float learning_rate = 0.5f;
+
+    using features_t = std::array<float, feature_count>;
+
+    /// \brief The entry_t struct           Per-key access features
+    struct entry_t
+    {
+        Key key;
+        uint64_t inserted_at;
+        uint64_t last_access;
+        uint64_t last_delta;
+        uint64_t previous_delta;
+        size_t weight;
+        size_t hits;
+        features_t snapshot;
+    };
+
+    /// \brief The sample_t struct          A (features, label) training pair
+    struct sample_t
+    {
+        features_t features;
+        float label;
+    };
+
+    /// \brief features                     Computes the feature vector of an entry at the current tick
+    /// \param entry                        The entry
+    /// \return                             The feature vector
+    features_t features(const entry_t& entry) const
+    {
+        auto age = std::log1p(static_cast<float>(m_clock - entry.inserted_at));
+        // Unknown inter-arrival deltas are approximated by the age of the entry
+        auto last = entry.hits > 0 ? std::log1p(static_cast<float>(entry.last_delta)) : age;
+        auto previous = entry.hits > 1 ? std::log1p(static_cast<float>(entry.previous_delta)) : last;
+        return features_t{
+            1.f,
+            last,
+            previous,
+            age,
+            std::log1p(static_cast<float>(entry.weight)),
+            std::log1p(static_cast<float>(entry.hits))
+        };
+    }
+
+    /// \brief predict                      Predicts log(1 + ticks until next access) for a feature vector
+    /// \param x                            The feature vector
+    /// \return                             The prediction
+    float predict(const features_t& x) const
+    {
+        float y = 0.f;
+        for (size_t i = 0; i < feature_count; i++) {
+            y += m_weights[i] * x[i];
+        }
+        return y;
+    }
+
+    /// \brief score                        Predicted amount of ticks until the next access of an entry
+    /// \param entry                        The entry
+    /// \return                             The score, the greater the better an eviction candidate
+    float score(const entry_t& entry) const
+    {
+        auto idle = static_cast<float>(m_clock - entry.last_access);
+        auto predicted = std::expm1(predict(entry.snapshot));
+        // An overdue entry is expected to wait at least as long again as it already did
+        return std::max(predicted, 2.f * idle) - idle;
+    }
+
+    /// \brief add_sample                   Stores a training sample, dropping it if the buffer is full
+    void add_sample(const features_t& x, float label)
+    {
+        if (m_samples.size() < m_max_samples) {
+            m_samples.push_back(sample_t{x, label});
+        }
+    }
+
+    /// \brief m_entries                    Dense array of resident entries (for O(1) sampling)
+    std::vector<entry_t> m_entries;
+    /// \brief m_index                      The Key->position in m_entries hashmap
+    std::unordered_map<Key, size_t, HashFunction, KeyEqual> m_index;
+    /// \brief m_samples                    Training samples gathered since the last maintenance
+    std::vector<sample_t> m_samples;
+    /// \brief m_weights                    The model
+    features_t m_weights;
+    /// \brief m_candidates                 The amount of entries sampled per eviction
+    size_t m_candidates;
+    /// \brief m_max_samples                The maximum amount of samples kept between trainings
+    size_t m_max_samples;
+    /// \brief m_clock                      Logical clock, one tick per insertion/access
+    uint64_t m_clock;
+    /// \brief m_rng                        Candidate sampler
+    std::mt19937_64 m_rng;
+};
@@ -8,9 +8,9 @@ using cache_value_t     = size_t;
 int main()
 {
     // Create a accepting records with capacity 10;
-    // key      std::pair<"std::string", int>, and
+    // key      std::pair<"std::string", int>, stored as a single integer, and
     // value    <int>
-    Cache<cache_key_t, cache_value_t, cache_key_hash_function> cache(10);
+    EncodedCache<cache_key_t, cache_value_t, symbol_date_codec, fixed_width_hash> cache(10);
 
     // Insert some different items in the cache
     cache.insert({"BTCUSD", "2019-01-01"}, 10000);
@@ -0,0 +1,233 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "hashing.hpp"
+
+template<
+    class Key,
+    class Value,
+    size_t Ways = 16,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The SetAssociativeCache class A hardware-style N-way set-associative cache.
+/// Every key hashes to exactly one set. A set keeps, in a single 64-byte aligned cache line, one tag byte
+/// and one age counter per way plus its own spinlock. A lookup locks only its set, compares all tags at
+/// once (SSE2 when available) and compares full keys only for matching tags. When a set is full its
+/// least recently used way is overwritten. There is no global recency structure, so the hit ratio is
+/// slightly lower than that of Cache, but every operation touches one line of metadata and one slot.
+/// The capacity is rounded up to a power of two amount of sets.
+class SetAssociativeCache
+{
+    static_assert(Ways == 8 || Ways == 16, "SetAssociativeCache supports 8 or 16 ways");
+
+public:
+    /// \brief SetAssociativeCache  Constructor
+    /// \param max_size             The minimum capacity of the cache
+    explicit SetAssociativeCache(size_t max_size)
+        : m_size(0)
+    {
+        size_t sets = 1;
+        while (sets * Ways < max_size) {
+            sets <<= 1;
+        }
+        m_set_mask = sets - 1;
+        m_sets = std::vector<set_t>(sets);
+        m_slots.resize(sets * Ways);
+    }
+
+    /// \brief Disable copy constructor
+    SetAssociativeCache(const SetAssociativeCache&) = delete;
+    /// \brief Disable copy assignment operator
+    SetAssociativeCache& operator=(const SetAssociativeCache&) = delete;
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    size_t size() const
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+
+    /// \brief capacity     Returns the maximum amount of key-value pairs
+    size_t capacity() const
+    {
+        return m_slots.size();
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists, and marks it most recently used
+    /// \param key          The Key
+    /// \return             Returns an std::pair<Value, bool>, see Cache::find
+    std::pair<Value, bool> find(const Key& key)
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        auto& set = m_sets[hash & m_set_mask];
+        set_lock_t lock(set);
+        auto way = match(set, key, hash);
+        if (way == Ways) {
+            return std::make_pair(Value{}, false);
+        }
+        touch(set, way);
+        return std::make_pair(slot(hash, way).second, true);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair. If its set is full, the least recently used
+    ///                     pair of the set is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed, 1 if Key is newly added
+    size_t insert(Key key, Value value)
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        auto& set = m_sets[hash & m_set_mask];
+        set_lock_t lock(set);
+        auto way = match(set, key, hash);
+        if (way != Ways) {
+            slot(hash, way).second = std::move(value);
+            touch(set, way);
+            return 0;
+        }
+
+        way = empty_way(set);
+        if (way == Ways) {
+            way = oldest_way(set);
+        }
+        else {
+            m_size.fetch_add(1, std::memory_order_relaxed);
+        }
+        set.tags[way] = tag(hash);
+        slot(hash, way) = std::make_pair(std::move(key), std::move(value));
+        touch(set, way);
+        return 1;
+    }
+
+private:
+    /// \brief The set_t struct         Metadata of one set, exactly one cache line
+    struct alignas(64) set_t
+    {
+        set_t()
+            : lock(0)
+        {
+            for (size_t way = 0; way < 16; way++) {
+                tags[way] = 0;
+                ages[way] = static_cast<uint8_t>(way);
+            }
+        }
+
+        /// \brief tags                 One byte of the hash per way, 0 marks an empty way
+        alignas(16) uint8_t tags[16];
+        /// \brief ages                 Recency rank per way, 0 is the most recently used
+        uint8_t ages[16];
+        /// \brief lock                 Spinlock of the set
+        std::atomic<uint8_t> lock;
+    };
+
+    /// \brief The set_lock_t struct    Scoped spinlock of a set
+    struct set_lock_t
+    {
+        explicit set_lock_t(set_t& set)
+            : m_set(set)
+        {
+            while (m_set.lock.exchange(1, std::memory_order_acquire)) {
+                while (m_set.lock.load(std::memory_order_relaxed)) {
+#if defined(__SSE2__)
+                    _mm_pause();
+#endif
+                }
+            }
+        }
+
+        ~set_lock_t()
+        {
+            m_set.lock.store(0, std::memory_order_release);
+        }
+
+        set_t& m_set;
+    };
+
+    /// \brief tag                      The non-zero tag byte of a hash
+    static uint8_t tag(uint64_t hash)
+    {
+        auto t = static_cast<uint8_t>(hash >> 56);
+        return t ? t : 1;
+    }
+
+    /// \brief tag_mask                 Bitmask of the ways whose tag equals a byte
+    static uint32_t tag_mask(const set_t& set, uint8_t byte)
+    {
+#if defined(__SSE2__)
+        auto needle = _mm_set1_epi8(static_cast<char>(byte));
+        auto tags = Ways == 16 ? _mm_load_si128(reinterpret_cast<const __m128i*>(set.tags))
+                               : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(set.tags));
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(tags, needle)));
+#else
+        uint32_t mask = 0;
+        for (size_t way = 0; way < Ways; way++) {
+            mask |= uint32_t(set.tags[way] == byte) << way;
+        }
+#endif
+        return mask & ((uint32_t(1) << Ways) - 1);
+    }
+
+    /// \brief match                    Finds the way holding a key
+    /// \return                         The way, Ways if the key is not in the set
+    size_t match(const set_t& set, const Key& key, uint64_t hash)
+    {
+        auto mask = tag_mask(set, tag(hash));
+        while (mask) {
+            auto way = static_cast<size_t>(__builtin_ctz(mask));
+            if (KeyEqual{}(slot(hash, way).first, key)) {
+                return way;
+            }
+            mask &= mask - 1;
+        }
+        return Ways;
+    }
+
+    /// \brief empty_way                The first empty way of a set, Ways if the set is full
+    static size_t empty_way(const set_t& set)
+    {
+        auto mask = tag_mask(set, 0);
+        return mask ? static_cast<size_t>(__builtin_ctz(mask)) : Ways;
+    }
+
+    /// \brief oldest_way               The least recently used way of a set
+    static size_t oldest_way(const set_t& set)
+    {
+        for (size_t way = 0; way < Ways; way++) {
+            if (set.ages[way] == Ways - 1) {
+                return way;
+            }
+        }
+        return 0;
+    }
+
+    /// \brief touch                    Marks a way most recently used; ages stay a permutation of 0..Ways-1
+    static void touch(set_t& set, size_t way)
+    {
+        auto age = set.ages[way];
+        for (size_t w = 0; w < Ways; w++) {
+            set.ages[w] += set.ages[w] < age;
+        }
+        set.ages[way] = 0;
+    }
+
+    /// \brief slot                     The key-value pair stored in a way of the set of a hash
+    std::pair<Key, Value>& slot(uint64_t hash, size_t way)
+    {
+        return m_slots[(hash & m_set_mask) * Ways + way];
+    }
+
+    /// \brief m_sets                   The set metadata, one cache line per set
+    std::vector<set_t> m_sets;
+    /// \brief m_slots                  The key-value pairs, Ways consecutive slots per set
+    std::vector<std::pair<Key, Value>> m_slots;
+    /// \brief m_set_mask               The amount of sets minus one
+    uint64_t m_set_mask;
+    /// \brief m_size                   The amount of inserted key-value pairs
+    std::atomic<size_t> m_size;
+};
@@ -0,0 +1,183 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "cache.hpp"
+#include "hashing.hpp"
+
+/// \brief default_shards Default amount of shards of a ShardedCache
+static const size_t default_shards = 16;
+
+template<
+    class Key,
+    class Value,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The ShardedCache class Splits the keys over independent Cache shards, each with its own mutex, so
+/// that threads touching different shards do not contend. Batched lookups and insertions group their keys by
+/// shard and lock every shard at most once per batch. Capacity and recency are per shard. Every Key is hashed
+/// once per operation; the hash value selects the shard and is reused by the shard's own hashmaps.
+class ShardedCache
+{
+public:
+    using shard_type = Cache<Key, Value, HashFunction, KeyEqual>;
+
+    /// \brief ShardedCache     Constructor
+    /// \param max_size         The maximum amount of key-value pairs, split evenly over the shards
+    /// \param shards           The amount of shards, at most max_size
+    explicit ShardedCache(size_t max_size = default_max_size, size_t shards = default_shards)
+    {
+        max_size = max_size ? max_size : 1;
+        shards = std::min(shards ? shards : 1, max_size);
+        // the first max_size % shards shards hold one more pair, so that the total is max_size
+        for (size_t i = 0; i < shards; i++) {
+            auto shard_size = max_size / shards + (i < max_size % shards ? 1 : 0);
+            m_shards.emplace_back(new shard_type(static_cast<int>(shard_size)));
+        }
+    }
+
+    /// \brief Disable copy constructor
+    ShardedCache(const ShardedCache&) = delete;
+    /// \brief Disable copy assignment operator
+    ShardedCache& operator=(const ShardedCache&) = delete;
+
+    /// \brief shards           The amount of shards
+    size_t shards() const
+    {
+        return m_shards.size();
+    }
+
+    /// \brief shard            A shard, e.g. to configure it
+    shard_type& shard(size_t index)
+    {
+        return *m_shards[index];
+    }
+
+    /// \brief size             The amount of inserted key-value pairs
+    size_t size()
+    {
+        size_t size = 0;
+        for (auto& shard : m_shards) {
+            size += shard->size();
+        }
+        return size;
+    }
+
+    /// \brief find             See Cache::find
+    std::pair<Value, bool> find(const Key& key)
+    {
+        auto hashed = shard_type::hash_key(key);
+        return m_shards[shard_of(hashed.hash)]->find(hashed);
+    }
+
+    /// \brief insert           See Cache::insert
+    size_t insert(const Key& key, Value value)
+    {
+        auto hashed = shard_type::hash_key(key);
+        return m_shards[shard_of(hashed.hash)]->insert(hashed, std::move(value));
+    }
+
+    /// \brief multi_find       See Cache::multi_find, every shard is locked at most once
+    void multi_find(const Key* keys, size_t count, Value* values, uint64_t* found)
+    {
+        std::vector<uint64_t> hashes(count);
+        std::vector<size_t> order;
+        std::vector<size_t> offsets;
+        group(keys, count, hashes, order, offsets);
+        for (size_t shard = 0; shard < m_shards.size(); shard++) {
+            if (offsets[shard + 1] != offsets[shard]) {
+                m_shards[shard]->multi_find(keys, offsets[shard + 1] - offsets[shard], values, found,
+                                            order.data() + offsets[shard], hashes.data());
+            }
+        }
+    }
+
+    /// \brief multi_insert     See Cache::multi_insert, every shard is locked at most once
+    size_t multi_insert(const Key* keys, const Value* values, size_t count)
+    {
+        std::vector<uint64_t> hashes(count);
+        std::vector<size_t> order;
+        std::vector<size_t> offsets;
+        group(keys, count, hashes, order, offsets);
+        size_t inserted = 0;
+        for (size_t shard = 0; shard < m_shards.size(); shard++) {
+            if (offsets[shard + 1] != offsets[shard]) {
+                inserted += m_shards[shard]->multi_insert(keys, values, offsets[shard + 1] - offsets[shard],
+                                                          order.data() + offsets[shard], hashes.data());
+            }
+        }
+        return inserted;
+    }
+
+#if defined(__cpp_lib_span)
+    /// \brief multi_find       See multi_find, throws std::length_error if values or found are too short
+    void multi_find(std::span<const Key> keys, std::span<Value> values, std::span<uint64_t> found)
+    {
+        if (values.size() < keys.size() || found.size() < (keys.size() + 63) / 64) {
+            throw std::length_error("multi_find output spans are shorter than the keys");
+        }
+        multi_find(keys.data(), keys.size(), values.data(), found.data());
+    }
+
+    /// \brief multi_insert     See multi_insert, throws std::length_error if values is shorter than keys
+    size_t multi_insert(std::span<const Key> keys, std::span<const Value> values)
+    {
+        if (values.size() < keys.size()) {
+            throw std::length_error("multi_insert values span is shorter than the keys");
+        }
+        return multi_insert(keys.data(), values.data(), keys.size());
+    }
+#endif
+
+private:
+    /// \brief shard_of         The shard of a Key, given its hash value. The hash is mixed first, so that the
+    ///                         shard does not depend on the bits that select the bucket within the shard.
+    size_t shard_of(uint64_t hash) const
+    {
+        return mix_hash(hash) % m_shards.size();
+    }
+
+    /// \brief hash_keys        The hash values of a batch of keys. Hash functions with a hash_batch (see
+    ///                         has_hash_batch) hash the whole batch at once.
+    void hash_keys(const Key* keys, size_t count, uint64_t* hashes) const
+    {
+        if constexpr (has_hash_batch<HashFunction, Key>::value) {
+            HashFunction::hash_batch(keys, count, hashes);
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                hashes[i] = HashFunction{}(keys[i]);
+            }
+        }
+    }
+
+    /// \brief group            Hashes a batch of keys and counting sorts their indices by shard
+    /// \param hashes           Receives the hash values of the keys
+    /// \param order            Receives the key indices, grouped by shard
+    /// \param offsets          Receives where the group of every shard starts in order, plus the end
+    void group(const Key* keys, size_t count, std::vector<uint64_t>& hashes, std::vector<size_t>& order,
+               std::vector<size_t>& offsets) const
+    {
+        hash_keys(keys, count, hashes.data());
+        std::vector<uint64_t> shard_of_key(count);
+        mix_hash_batch(hashes.data(), count, shard_of_key.data());
+        offsets.assign(m_shards.size() + 1, 0);
+        for (size_t i = 0; i < count; i++) {
+            shard_of_key[i] %= m_shards.size();
+            offsets[shard_of_key[i] + 1]++;
+        }
+        for (size_t shard = 0; shard < m_shards.size(); shard++) {
+            offsets[shard + 1] += offsets[shard];
+        }
+        order.resize(count);
+        auto next = offsets;
+        for (size_t i = 0; i < count; i++) {
+            order[next[shard_of_key[i]]++] = i;
+        }
+    }
+
+    /// \brief m_shards         The shards
+    std::vector<std::unique_ptr<shard_type>> m_shards;
+};
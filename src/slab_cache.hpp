@@ -0,0 +1,710 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "epoch_pins.hpp"
+
+/// \brief default_slab_page_size Default size in bytes of the largest pages SlabCache assigns to its size classes
+static const size_t default_slab_page_size = 1 << 20;
+/// \brief default_slab_min_chunk Default size in bytes of the chunks of the smallest size class of SlabCache
+static const size_t default_slab_min_chunk = 64;
+/// \brief default_slab_growth_factor Default ratio between the chunk sizes of consecutive size classes
+static const double default_slab_growth_factor = 1.125;
+/// \brief default_slab_rebalance_interval Default period at which SlabCache moves pages between size classes
+static const std::chrono::milliseconds default_slab_rebalance_interval(1000);
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The SlabCache class A memcached-style cache of byte-string Values of widely varying sizes, e.g. from
+/// 100 bytes to 64 KiB. Memory is split into pages, and every page belongs to one size class and is cut into
+/// chunks of its size; the chunk sizes grow geometrically, by growth_factor, so a Value wastes on average less
+/// than growth_factor - 1 of its chunk and freed chunks are reused by Values of the same class, without
+/// fragmenting the pages. The pages of a class hold a whole number of chunks: at least min_page_chunks, and at
+/// least page_size / small_page_divisor bytes, up to page_size. Pages of small chunks are thus small, and a
+/// class whose pairs take less than a page strands few bytes in its free chunks. As in memcached, a chunk starts
+/// with the item header of its pair (the Key, the length of the Value and its links, see header_size), followed
+/// by the Value, and the index of the Keys is chained through the headers, so the Keys and the metadata of the
+/// pairs count towards max_bytes; only the bucket array of the index, up to two words per pair, and the heap
+/// memory Keys may own live outside the pages. Every class has its own free list and its own LRU list, and a
+/// full class evicts its least recently used pair. Like BytesCache, lookups return views into the chunks, valid
+/// while the reader holds the pin_t it took before the lookup: freed chunks wait in a limbo list until no pin of
+/// their epoch or an older one remains (see epoch_pins_t). The pages never exceed max_bytes: insertions into a
+/// full class whose freed chunks are all in limbo are rejected instead.
+///
+/// Classes whose pairs are evicted most need more pages than they got when the cache filled up. A background
+/// rebalancer, run every rebalance_interval, compares the evictions and rejected insertions of every class
+/// since its previous run, and frees pages of other classes until the class with the most pressure can
+/// allocate as many bytes as it evicted or rejected, see rebalance. A single mutex synchronizes the cache.
+class SlabCache
+{
+public:
+    /// \brief pin_t        Guards the views returned by lookups, see epoch_pins_t
+    using pin_t = epoch_pins_t::pin_t;
+
+    /// \brief SlabCache            Constructor, pages are allocated on demand
+    /// \param max_bytes            The maximum amount of bytes of the pages, at least page_size
+    /// \param page_size            The size of the largest pages, and of the chunks of the largest class; Values
+    ///                             longer than page_size minus an item header are never cached
+    /// \param growth_factor        The ratio between the chunk sizes of consecutive classes, above 1
+    /// \param rebalance_interval   The period of the rebalancer, zero to only rebalance via rebalance
+    explicit SlabCache(size_t max_bytes, size_t page_size = default_slab_page_size,
+                       double growth_factor = default_slab_growth_factor,
+                       std::chrono::milliseconds rebalance_interval = default_slab_rebalance_interval)
+        : m_page_size(page_size),
+          m_max_bytes(std::max(max_bytes, page_size)),
+          m_bytes(0),
+          m_buckets(16, nil),
+          m_size(0),
+          m_stored(0),
+          m_stop(false)
+    {
+        if (page_size < default_slab_min_chunk || page_size > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("SlabCache supports pages of default_slab_min_chunk bytes to 4 GiB");
+        }
+        if (page_size <= sizeof(item_t)) {
+            throw std::length_error("SlabCache pages must be longer than an item header");
+        }
+        if (!(growth_factor > 1.0)) {
+            throw std::invalid_argument("SlabCache requires a growth factor above 1");
+        }
+        for (size_t chunk_size = default_slab_min_chunk; ; ) {
+            auto chunks = std::max(min_page_chunks, page_size / small_page_divisor / chunk_size);
+            m_classes.emplace_back(chunk_size, std::max<size_t>(std::min(chunks, page_size / chunk_size), 1));
+            if (chunk_size == page_size) {
+                break;
+            }
+            // chunks start at multiples of 8 bytes, except the single chunk of the largest class
+            auto next = std::max(static_cast<size_t>(chunk_size * growth_factor), chunk_size + 8);
+            chunk_size = std::min((next + 7) / 8 * 8, page_size);
+        }
+        if (rebalance_interval.count() > 0) {
+            m_rebalancer = std::thread(
+                    [this, rebalance_interval]() {
+                        std::unique_lock<std::mutex> lock(m_rebalancer_mutex);
+                        while (!m_rebalancer_cv.wait_for(lock, rebalance_interval, [this]() { return m_stop; })) {
+                            rebalance();
+                        }
+                    });
+        }
+    }
+
+    /// \brief Disable copy constructor
+    SlabCache(const SlabCache&) = delete;
+    /// \brief Disable copy assignment operator
+    SlabCache& operator=(const SlabCache&) = delete;
+
+    ~SlabCache()
+    {
+        if (m_rebalancer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_rebalancer_mutex);
+                m_stop = true;
+            }
+            m_rebalancer_cv.notify_all();
+            m_rebalancer.join();
+        }
+        for (auto& cls : m_classes) {
+            for (auto page : cls.pages) {
+                destroy_headers(page);
+            }
+        }
+    }
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size;
+    }
+
+    /// \brief capacity     Returns the maximum amount of bytes of the pages
+    size_t capacity() const
+    {
+        return m_max_bytes;
+    }
+
+    /// \brief memory       Returns the amount of bytes of all allocated pages, including those in limbo
+    size_t memory()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bytes;
+    }
+
+    /// \brief stored       Returns the total length of the stored Values
+    size_t stored()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stored;
+    }
+
+    /// \brief header_size  Returns the bytes of the item header that starts every chunk: the Key, the length of
+    ///                     the Value and the links of the LRU list and of the index
+    static constexpr size_t header_size()
+    {
+        return sizeof(item_t);
+    }
+
+    /// \brief classes      Returns the amount of size classes
+    size_t classes() const
+    {
+        return m_classes.size();
+    }
+
+    /// \brief pages        Returns the amount of pages assigned to the size class of Values of a length
+    size_t pages(size_t length)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return fits(length) ? m_classes[class_of(length)].pages.size() : 0;
+    }
+
+    /// \brief pin          Pins the current epoch, so that the views of later lookups stay valid
+    /// \return             The pin, which must not outlive the cache
+    pin_t pin() const
+    {
+        return m_pins.pin();
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists, and marks it most recently used in
+    ///                     its class
+    /// \param key          The Key
+    /// \param pin          A pin of this cache, taken before the lookup, that keeps the view valid
+    /// \return             Returns an std::pair<std::string_view, bool>, see BytesCache::find
+    std::pair<std::string_view, bool> find(const Key& key, const pin_t& pin)
+    {
+        (void)pin;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto ref = lookup(key);
+        if (ref == nil) {
+            return std::make_pair(std::string_view(), false);
+        }
+        touch(m_classes[m_pages[page_of(ref)].cls], ref);
+        return std::make_pair(std::string_view(value_of(ref), item(ref).length), true);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair, copying the Value into a chunk of its size
+    ///                     class. If the class has no free chunk and max_bytes leaves no room for one of its
+    ///                     pages, the least recently used pair of the class is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed or the Value could not be stored, 1 if Key is newly added.
+    ///                     A Value that does not fit a page (see header_size), or of a class without free
+    ///                     chunk, page or pair to evict (see allocate), is not stored, and the previous Value
+    ///                     of the Key is removed.
+    size_t insert(const Key& key, std::string_view value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool existed = lookup(key) != nil;
+        auto ref = fits(value.size()) ? allocate(class_of(value.size())) : nil;
+        // the allocation may have evicted the Key itself
+        auto previous = existed ? lookup(key) : nil;
+        if (previous != nil) {
+            remove(previous);
+        }
+        if (ref == nil) {
+            return 0;
+        }
+
+        auto& i = item(ref);
+        i.key = key;
+        i.length = static_cast<uint32_t>(value.size());
+        std::memcpy(value_of(ref), value.data(), value.size());
+        push_front(m_classes[m_pages[page_of(ref)].cls], ref);
+        index(ref);
+        m_pages[page_of(ref)].used++;
+        m_stored += value.size();
+        return existed ? 0 : 1;
+    }
+
+    /// \brief rebalance    Moves memory to the size class with the most evictions and rejected insertions
+    ///                     since the previous call: the donors (see donor) free pages until the chunks of the
+    ///                     pairs it evicted or rejected, rounded up to its pages, are freed, and the class
+    ///                     allocates pages in their place, so that the pages follow a shift in the mix of Value
+    ///                     sizes within a few calls. Called periodically by the rebalancer thread.
+    /// \return             Whether a page was moved
+    bool rebalance()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<uint64_t> pressure(m_classes.size());
+        size_t receiver = 0;
+        for (size_t c = 0; c < m_classes.size(); c++) {
+            auto& cls = m_classes[c];
+            // donors are chosen by their free chunks, see donor
+            reclaim(cls);
+            pressure[c] = cls.pressure - cls.last_pressure;
+            cls.last_pressure = cls.pressure;
+            if (pressure[c] > pressure[receiver]) {
+                receiver = c;
+            }
+        }
+        if (pressure[receiver] == 0) {
+            return false;
+        }
+        auto page_bytes = m_classes[receiver].page_bytes();
+        auto wanted = (pressure[receiver] * m_classes[receiver].chunk_size + page_bytes - 1) / page_bytes *
+                      page_bytes;
+        uint64_t moved = 0;
+        while (moved < wanted) {
+            auto c = donor(receiver, pressure);
+            if (c == m_classes.size()) {
+                break;
+            }
+            moved += m_classes[c].page_bytes();
+            move_page(c, sparsest_page(c), receiver);
+        }
+        return moved > 0;
+    }
+
+private:
+    /// \brief The item_t struct    The header of a chunk: the pair stored in it, whose Value follows the header,
+    /// and its neighbours in the LRU list of its class and in its bucket of the index
+    struct item_t
+    {
+        Key key;
+        uint32_t length;
+        /// \brief newer            The next more recently used chunk, nil for the head, absent if not in use
+        uint64_t newer;
+        /// \brief older            The next less recently used chunk, nil for the tail
+        uint64_t older;
+        /// \brief next             The next chunk of the same bucket of the index, nil for the last
+        uint64_t next;
+    };
+
+    static_assert(alignof(item_t) <= 8, "SlabCache places item headers at chunk boundaries aligned to 8 bytes");
+
+    /// \brief The page_t struct    A page, whose chunks start with their item headers
+    struct page_t
+    {
+        /// \brief data             The chunks, null once the page is freed
+        std::unique_ptr<char[]> data;
+        /// \brief cls              The size class the page is assigned to
+        uint32_t cls;
+        /// \brief used             The amount of chunks in use
+        uint32_t used;
+    };
+
+    /// \brief The limbo_t struct   A chunk or a page freed while pins may still view it
+    struct limbo_t
+    {
+        uint64_t ref;
+        /// \brief retired_at       The epoch it was freed in
+        uint64_t retired_at;
+    };
+
+    /// \brief The class_t struct   A size class
+    struct class_t
+    {
+        class_t(size_t chunk_size, size_t chunks)
+            : chunk_size(chunk_size), chunks(chunks), head(nil), tail(nil), pressure(0), last_pressure(0)
+        {}
+
+        /// \brief page_bytes       The size of the pages of the class
+        size_t page_bytes() const
+        {
+            return chunk_size * chunks;
+        }
+
+        size_t chunk_size;
+        /// \brief chunks           The amount of chunks per page
+        size_t chunks;
+        /// \brief pages            The pages assigned to the class
+        std::vector<uint32_t> pages;
+        /// \brief free             The free chunks
+        std::vector<uint64_t> free;
+        /// \brief limbo            The freed chunks that pins may still view, oldest first
+        std::deque<limbo_t> limbo;
+        /// \brief head             The most recently used chunk
+        uint64_t head;
+        /// \brief tail             The least recently used chunk
+        uint64_t tail;
+        /// \brief pressure         The amount of evictions and rejected insertions
+        uint64_t pressure;
+        /// \brief last_pressure    The pressure at the previous rebalance
+        uint64_t last_pressure;
+    };
+
+    /// \brief min_page_chunks      The least amount of chunks of a page, unless it holds the largest class
+    static constexpr size_t min_page_chunks = 16;
+    /// \brief small_page_divisor   The pages of the classes of small chunks take page_size / small_page_divisor
+    ///                             bytes
+    static constexpr size_t small_page_divisor = 16;
+    /// \brief nil                  Marks the ends of the LRU lists and failed allocations
+    static constexpr uint64_t nil = std::numeric_limits<uint64_t>::max();
+    /// \brief absent               Marks the chunks that are not in use
+    static constexpr uint64_t absent = nil - 1;
+
+    /// \brief make_ref             A chunk reference, the page in the upper and the chunk in the lower 32 bits
+    static uint64_t make_ref(uint32_t page, uint32_t slot)
+    {
+        return (static_cast<uint64_t>(page) << 32) | slot;
+    }
+
+    static uint32_t page_of(uint64_t ref)
+    {
+        return static_cast<uint32_t>(ref >> 32);
+    }
+
+    static uint32_t slot_of(uint64_t ref)
+    {
+        return static_cast<uint32_t>(ref);
+    }
+
+    char* chunk(uint64_t ref)
+    {
+        auto& page = m_pages[page_of(ref)];
+        return page.data.get() + slot_of(ref) * m_classes[page.cls].chunk_size;
+    }
+
+    item_t& item(uint64_t ref)
+    {
+        return *std::launder(reinterpret_cast<item_t*>(chunk(ref)));
+    }
+
+    /// \brief value_of             The Value of a chunk, which follows its item header
+    char* value_of(uint64_t ref)
+    {
+        return chunk(ref) + sizeof(item_t);
+    }
+
+    /// \brief fits                 Whether a Value of a length fits a page after its item header
+    bool fits(size_t length) const
+    {
+        return length <= m_page_size - sizeof(item_t);
+    }
+
+    /// \brief class_of             The smallest size class whose chunks fit a Value of a length and its header
+    size_t class_of(size_t length) const
+    {
+        auto it = std::lower_bound(m_classes.begin(), m_classes.end(), length + sizeof(item_t),
+                                   [](const class_t& cls, size_t length) { return cls.chunk_size < length; });
+        return static_cast<size_t>(it - m_classes.begin());
+    }
+
+    /// \brief bucket               The bucket of the index a Key belongs to
+    uint64_t& bucket(const Key& key)
+    {
+        return m_buckets[HashFunction{}(key) % m_buckets.size()];
+    }
+
+    /// \brief lookup               The chunk holding the pair of a Key, nil if there is none
+    uint64_t lookup(const Key& key)
+    {
+        for (auto ref = bucket(key); ref != nil; ref = item(ref).next) {
+            if (KeyEqual{}(item(ref).key, key)) {
+                return ref;
+            }
+        }
+        return nil;
+    }
+
+    /// \brief index                Adds a chunk in use to the index, which doubles its buckets when it holds
+    ///                             more pairs than buckets
+    void index(uint64_t ref)
+    {
+        if (++m_size > m_buckets.size()) {
+            std::vector<uint64_t> buckets(m_buckets.size() * 2, nil);
+            m_buckets.swap(buckets);
+            for (auto chained : buckets) {
+                while (chained != nil) {
+                    auto next = item(chained).next;
+                    auto& head = bucket(item(chained).key);
+                    item(chained).next = head;
+                    head = chained;
+                    chained = next;
+                }
+            }
+        }
+        auto& head = bucket(item(ref).key);
+        item(ref).next = head;
+        head = ref;
+    }
+
+    /// \brief unindex              Removes a chunk in use from the index
+    void unindex(uint64_t ref)
+    {
+        auto* link = &bucket(item(ref).key);
+        while (*link != ref) {
+            link = &item(*link).next;
+        }
+        *link = item(ref).next;
+        m_size--;
+    }
+
+    /// \brief remove               Removes the pair of a chunk in use from the index and releases the chunk
+    void remove(uint64_t ref)
+    {
+        unindex(ref);
+        release(ref);
+    }
+
+    /// \brief allocate             Returns a free chunk of a class: a reclaimed one, one of a new page,
+    ///                             or else one freed by evicting the least recently used pair of the class.
+    ///                             Returns nil if there is none, e.g. while pins keep the freed chunks in limbo.
+    uint64_t allocate(size_t c)
+    {
+        auto& cls = m_classes[c];
+        reclaim(cls);
+        if (cls.free.empty() && m_bytes + cls.page_bytes() <= m_max_bytes) {
+            new_page(c);
+        }
+        if (cls.free.empty() && cls.limbo.empty() && cls.tail != nil) {
+            // while pins keep freed chunks in limbo, evicting more pairs would not free a chunk either
+            remove(cls.tail);
+            cls.pressure++;
+            reclaim(cls);
+        }
+        if (cls.free.empty()) {
+            cls.pressure++;
+            return nil;
+        }
+        auto ref = cls.free.back();
+        cls.free.pop_back();
+        return ref;
+    }
+
+    /// \brief new_page             Allocates a page of a class, reusing the slot of a freed page if there is one,
+    ///                             constructs the headers of its chunks and frees them
+    void new_page(size_t c)
+    {
+        auto& cls = m_classes[c];
+        uint32_t page;
+        if (m_free_ids.empty()) {
+            page = static_cast<uint32_t>(m_pages.size());
+            m_pages.emplace_back();
+        } else {
+            page = m_free_ids.back();
+            m_free_ids.pop_back();
+        }
+        auto& p = m_pages[page];
+        p.data.reset(new char[cls.page_bytes()]);
+        p.cls = static_cast<uint32_t>(c);
+        p.used = 0;
+        m_bytes += cls.page_bytes();
+        for (size_t slot = 0; slot < cls.chunks; slot++) {
+            new (p.data.get() + slot * cls.chunk_size) item_t{Key{}, 0, absent, absent, nil};
+        }
+        cls.pages.push_back(page);
+        for (size_t slot = cls.chunks; slot-- > 0; ) {
+            cls.free.push_back(make_ref(page, static_cast<uint32_t>(slot)));
+        }
+    }
+
+    /// \brief delete_page          Frees a page whose headers were destroyed
+    void delete_page(uint32_t page)
+    {
+        m_pages[page].data.reset();
+        m_bytes -= m_classes[m_pages[page].cls].page_bytes();
+        m_free_ids.push_back(page);
+    }
+
+    /// \brief destroy_headers      Destroys the headers of the chunks of a page, before it is freed
+    void destroy_headers(uint32_t page)
+    {
+        for (uint32_t slot = 0; slot < m_classes[m_pages[page].cls].chunks; slot++) {
+            item(make_ref(page, slot)).~item_t();
+        }
+    }
+
+    /// \brief release              Unlinks a chunk in use and moves it to the limbo list of its class
+    void release(uint64_t ref)
+    {
+        auto& cls = m_classes[m_pages[page_of(ref)].cls];
+        unlink(cls, ref);
+        item(ref).newer = absent;
+        m_pages[page_of(ref)].used--;
+        m_stored -= item(ref).length;
+        cls.limbo.push_back(limbo_t{ref, m_pins.retire()});
+    }
+
+    /// \brief reclaim              Frees the chunks of a class and the moved pages that no pin can still view,
+    ///                             and allocates a page of the receiving class of every moved page in its place
+    ///                             if the freed bytes allow it; any class allocates the bytes left, see allocate
+    void reclaim(class_t& cls)
+    {
+        auto oldest = m_pins.oldest();
+        while (!cls.limbo.empty() && cls.limbo.front().retired_at < oldest) {
+            cls.free.push_back(cls.limbo.front().ref);
+            cls.limbo.pop_front();
+        }
+        while (!m_page_limbo.empty() && m_page_limbo.front().retired_at < oldest) {
+            // a page in limbo refers to its receiving class in place of a chunk
+            auto receiver = slot_of(m_page_limbo.front().ref);
+            delete_page(page_of(m_page_limbo.front().ref));
+            m_page_limbo.pop_front();
+            if (m_bytes + m_classes[receiver].page_bytes() <= m_max_bytes) {
+                new_page(receiver);
+            }
+        }
+    }
+
+    /// \brief donor                The class that gives a page to a receiver, or the amount of classes if none
+    ///                             does. Classes whose free chunks add up to a page come first, the most free
+    ///                             bytes first: their other pages take in the pairs of the moved page, so no
+    ///                             pair is evicted. Otherwise the class with the least pressure (and then the
+    ///                             most free bytes) gives a page, if it had less than half the pressure of the
+    ///                             receiver and has more than one page.
+    size_t donor(size_t receiver, const std::vector<uint64_t>& pressure) const
+    {
+        auto none = m_classes.size();
+        auto lossless = none;
+        auto pressured = none;
+        auto free_bytes = [this](size_t c) { return m_classes[c].free.size() * m_classes[c].chunk_size; };
+        for (size_t c = 0; c < m_classes.size(); c++) {
+            auto& cls = m_classes[c];
+            if (c == receiver || cls.pages.empty()) {
+                continue;
+            }
+            if (cls.free.size() >= cls.chunks && (lossless == none || free_bytes(c) > free_bytes(lossless))) {
+                lossless = c;
+            }
+            if (cls.pages.size() > 1 && pressure[c] * 2 < pressure[receiver] &&
+                (pressured == none || pressure[c] < pressure[pressured] ||
+                 (pressure[c] == pressure[pressured] && free_bytes(c) > free_bytes(pressured)))) {
+                pressured = c;
+            }
+        }
+        return lossless != none ? lossless : pressured;
+    }
+
+    /// \brief sparsest_page        The page of a class with the fewest chunks in use, preferring the page of its
+    ///                             least recently used pair
+    uint32_t sparsest_page(size_t c) const
+    {
+        auto& cls = m_classes[c];
+        auto sparsest = cls.tail != nil ? page_of(cls.tail) : cls.pages.front();
+        for (auto page : cls.pages) {
+            if (m_pages[page].used < m_pages[sparsest].used) {
+                sparsest = page;
+            }
+        }
+        return sparsest;
+    }
+
+    /// \brief rescue               Copies the pair of a chunk in use into a free chunk of the same class, which
+    ///                             takes its place in the LRU list and in the index
+    void rescue(class_t& cls, uint64_t from, uint64_t to)
+    {
+        unindex(from);
+        auto& source = item(from);
+        auto& target = item(to);
+        target.key = std::move(source.key);
+        target.length = source.length;
+        std::memcpy(value_of(to), value_of(from), source.length);
+        target.newer = source.newer;
+        target.older = source.older;
+        (target.newer != nil ? item(target.newer).older : cls.head) = to;
+        (target.older != nil ? item(target.older).newer : cls.tail) = to;
+        source.newer = absent;
+        index(to);
+        m_pages[page_of(to)].used++;
+    }
+
+    /// \brief move_page            Frees a page of the donor for the receiver, once no pin can still view it. The
+    ///                             pairs of the page are rescued into the free chunks of the other pages of the
+    ///                             donor while there are any, and evicted otherwise.
+    void move_page(size_t donor, uint32_t page, size_t receiver)
+    {
+        auto& cls = m_classes[donor];
+        auto in_page = [page](uint64_t ref) { return page_of(ref) == page; };
+        cls.free.erase(std::remove_if(cls.free.begin(), cls.free.end(), in_page), cls.free.end());
+        cls.limbo.erase(std::remove_if(cls.limbo.begin(), cls.limbo.end(),
+                                       [&in_page](const limbo_t& l) { return in_page(l.ref); }),
+                        cls.limbo.end());
+        for (uint32_t slot = 0; slot < cls.chunks; slot++) {
+            auto ref = make_ref(page, slot);
+            if (item(ref).newer == absent) {
+                continue;
+            }
+            if (!cls.free.empty()) {
+                rescue(cls, ref, cls.free.back());
+                cls.free.pop_back();
+                continue;
+            }
+            unindex(ref);
+            unlink(cls, ref);
+            item(ref).newer = absent;
+            m_stored -= item(ref).length;
+        }
+        m_pages[page].used = 0;
+        // readers may still view the Values of the page, but never its headers
+        destroy_headers(page);
+        cls.pages.erase(std::find(cls.pages.begin(), cls.pages.end(), page));
+        m_page_limbo.push_back(limbo_t{make_ref(page, static_cast<uint32_t>(receiver)), m_pins.retire()});
+        reclaim(m_classes[receiver]);
+    }
+
+    /// \brief unlink               Removes a chunk in use from the LRU list of its class
+    void unlink(class_t& cls, uint64_t ref)
+    {
+        auto& i = item(ref);
+        (i.newer != nil ? item(i.newer).older : cls.head) = i.older;
+        (i.older != nil ? item(i.older).newer : cls.tail) = i.newer;
+    }
+
+    /// \brief push_front           Makes a chunk the head of the LRU list of its class
+    void push_front(class_t& cls, uint64_t ref)
+    {
+        auto& i = item(ref);
+        i.newer = nil;
+        i.older = cls.head;
+        (cls.head != nil ? item(cls.head).newer : cls.tail) = ref;
+        cls.head = ref;
+    }
+
+    /// \brief touch                Marks a chunk in use most recently used in its class
+    void touch(class_t& cls, uint64_t ref)
+    {
+        if (ref != cls.head) {
+            unlink(cls, ref);
+            push_front(cls, ref);
+        }
+    }
+
+    /// \brief m_page_size          The size of the largest pages
+    const size_t m_page_size;
+    /// \brief m_max_bytes          The maximum amount of bytes of the pages
+    const size_t m_max_bytes;
+    /// \brief m_bytes              The amount of bytes of the allocated pages, including those in limbo
+    size_t m_bytes;
+    /// \brief m_classes            The size classes, by increasing chunk size
+    std::vector<class_t> m_classes;
+    /// \brief m_pages              The pages, indexed by the upper half of the chunk references
+    std::vector<page_t> m_pages;
+    /// \brief m_free_ids           The indices of the freed pages in m_pages, reused by new pages
+    std::vector<uint32_t> m_free_ids;
+    /// \brief m_page_limbo         The pages moved between classes that pins may still view, oldest first
+    std::deque<limbo_t> m_page_limbo;
+    /// \brief m_buckets            The first chunk of every bucket of the index, chained through item_t::next
+    std::vector<uint64_t> m_buckets;
+    /// \brief m_size               The amount of pairs
+    size_t m_size;
+    /// \brief m_stored             The total length of the stored Values
+    size_t m_stored;
+    /// \brief m_mutex              Guards the cache
+    std::mutex m_mutex;
+    /// \brief m_pins               The pins of the readers, see epoch_pins_t
+    epoch_pins_t m_pins;
+    /// \brief m_rebalancer_mutex   Guards m_stop
+    std::mutex m_rebalancer_mutex;
+    /// \brief m_rebalancer_cv      Wakes the rebalancer up when the cache is destroyed
+    std::condition_variable m_rebalancer_cv;
+    /// \brief m_stop               Stops the rebalancer
+    bool m_stop;
+    /// \brief m_rebalancer         Runs rebalance periodically
+    std::thread m_rebalancer;
+};
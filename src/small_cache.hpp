@@ -0,0 +1,205 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "hashing.hpp"
+
+template<
+    class Key,
+    class Value,
+    size_t Capacity = 32,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The SmallCache class An LRU cache for small capacities (up to 64 pairs), e.g. per-connection caches.
+/// All storage is inline in the object: one tag byte of the hash and one recency rank per slot, a one-byte
+/// spinlock and the key-value pairs. A lookup compares all tags at once (SSE2 when available, 16 slots per
+/// instruction) and compares full keys only for matching tags. Ranks are updated with the same vector
+/// compares. Unlike Cache there are no hashmaps and no mutex, and nothing is allocated by the cache itself.
+class SmallCache
+{
+    static_assert(Capacity > 0 && Capacity <= 64, "SmallCache supports capacities of 1 to 64 pairs");
+
+public:
+    SmallCache()
+        : m_size(0), m_lock(0)
+    {
+        for (size_t slot = 0; slot < padded; slot++) {
+            m_tags[slot] = 0;
+            // ranks stay a permutation of 0..Capacity-1, the padding never ages
+            m_ranks[slot] = static_cast<int8_t>(slot < Capacity ? slot : padding_rank);
+        }
+    }
+
+    /// \brief Disable copy constructor
+    SmallCache(const SmallCache&) = delete;
+    /// \brief Disable copy assignment operator
+    SmallCache& operator=(const SmallCache&) = delete;
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    size_t size() const
+    {
+        lock_t lock(m_lock);
+        return m_size;
+    }
+
+    /// \brief capacity     Returns the maximum amount of key-value pairs
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists, and marks it most recently used
+    /// \param key          The Key
+    /// \return             Returns an std::pair<Value, bool>, see Cache::find
+    std::pair<Value, bool> find(const Key& key)
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        lock_t lock(m_lock);
+        auto slot = match(key, hash);
+        if (slot == Capacity) {
+            return std::make_pair(Value{}, false);
+        }
+        touch(slot);
+        return std::make_pair(m_slots[slot].second, true);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair. If the cache is full, the least recently used
+    ///                     pair is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed, 1 if Key is newly added
+    size_t insert(Key key, Value value)
+    {
+        auto hash = mix_hash(HashFunction{}(key));
+        lock_t lock(m_lock);
+        auto slot = match(key, hash);
+        if (slot != Capacity) {
+            m_slots[slot].second = std::move(value);
+            touch(slot);
+            return 0;
+        }
+
+        if (m_size < Capacity) {
+            slot = lowest(mask_of(m_tags, 0));
+            m_size++;
+        }
+        else {
+            slot = lowest(mask_of(m_ranks, static_cast<int8_t>(Capacity - 1)));
+        }
+        m_tags[slot] = tag(hash);
+        m_slots[slot] = std::make_pair(std::move(key), std::move(value));
+        touch(slot);
+        return 1;
+    }
+
+private:
+    /// \brief padded           The amount of tags and ranks, rounded up to whole vectors
+    static const size_t padded = (Capacity + 15) / 16 * 16;
+    /// \brief padding_rank     The rank of the padding slots, never lower than a touched rank
+    static const int8_t padding_rank = 127;
+
+    /// \brief The lock_t struct    Scoped spinlock
+    struct lock_t
+    {
+        explicit lock_t(std::atomic<uint8_t>& lock)
+            : m_lock(lock)
+        {
+            while (m_lock.exchange(1, std::memory_order_acquire)) {
+                while (m_lock.load(std::memory_order_relaxed)) {
+#if defined(__SSE2__)
+                    _mm_pause();
+#endif
+                }
+            }
+        }
+
+        ~lock_t()
+        {
+            m_lock.store(0, std::memory_order_release);
+        }
+
+        std::atomic<uint8_t>& m_lock;
+    };
+
+    /// \brief tag              The non-zero tag byte of a hash
+    static int8_t tag(uint64_t hash)
+    {
+        auto t = static_cast<int8_t>(hash >> 56);
+        return t ? t : 1;
+    }
+
+    /// \brief mask_of          Bitmask of the slots whose byte equals a given byte
+    static uint64_t mask_of(const int8_t* bytes, int8_t byte)
+    {
+        uint64_t mask = 0;
+#if defined(__SSE2__)
+        auto needle = _mm_set1_epi8(byte);
+        for (size_t i = 0; i < padded; i += 16) {
+            auto chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes + i));
+            mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)))) << i;
+        }
+#else
+        for (size_t i = 0; i < Capacity; i++) {
+            mask |= uint64_t(bytes[i] == byte) << i;
+        }
+#endif
+        return Capacity == 64 ? mask : mask & ((uint64_t(1) << Capacity) - 1);
+    }
+
+    /// \brief lowest           The lowest slot of a non-empty mask
+    static size_t lowest(uint64_t mask)
+    {
+        return static_cast<size_t>(__builtin_ctzll(mask));
+    }
+
+    /// \brief match            Finds the slot holding a key
+    /// \return                 The slot, Capacity if the key is not cached
+    size_t match(const Key& key, uint64_t hash) const
+    {
+        auto mask = mask_of(m_tags, tag(hash));
+        while (mask) {
+            auto slot = lowest(mask);
+            if (KeyEqual{}(m_slots[slot].first, key)) {
+                return slot;
+            }
+            mask &= mask - 1;
+        }
+        return Capacity;
+    }
+
+    /// \brief touch            Marks a slot most recently used: the ranks below its rank grow by one
+    void touch(size_t slot)
+    {
+        auto rank = m_ranks[slot];
+#if defined(__SSE2__)
+        auto pivot = _mm_set1_epi8(rank);
+        for (size_t i = 0; i < padded; i += 16) {
+            auto chunk = reinterpret_cast<__m128i*>(m_ranks + i);
+            auto ranks = _mm_load_si128(chunk);
+            // lower ranks compare to -1, subtracting it adds one
+            _mm_store_si128(chunk, _mm_sub_epi8(ranks, _mm_cmplt_epi8(ranks, pivot)));
+        }
+#else
+        for (size_t i = 0; i < Capacity; i++) {
+            m_ranks[i] += m_ranks[i] < rank;
+        }
+#endif
+        m_ranks[slot] = 0;
+    }
+
+    /// \brief m_tags           One byte of the hash per slot, 0 marks an empty slot
+    alignas(16) int8_t m_tags[padded];
+    /// \brief m_ranks          Recency rank per slot, 0 is the most recently used
+    alignas(16) int8_t m_ranks[padded];
+    /// \brief m_size           The amount of inserted key-value pairs
+    uint8_t m_size;
+    /// \brief m_lock           Spinlock of the cache
+    mutable std::atomic<uint8_t> m_lock;
+    /// \brief m_slots          The key-value pairs
+    std::pair<Key, Value> m_slots[Capacity];
+};
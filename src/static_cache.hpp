@@ -0,0 +1,199 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include "hashing.hpp"
+
+/// \brief static_index_t The narrowest unsigned integer indexing N nodes, with its maximum value left as nil
+template<size_t N>
+using static_index_t = typename std::conditional<(N < std::numeric_limits<uint8_t>::max()), uint8_t,
+                       typename std::conditional<(N < std::numeric_limits<uint16_t>::max()), uint16_t,
+                                                 uint32_t>::type>::type;
+
+template<
+    class Key,
+    class Value,
+    size_t N,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The StaticCache class An LRU cache whose capacity N is known at compile time, e.g. a per-thread
+/// memoization table. All storage is inline in the object, in std::arrays: N nodes (key, value and the
+/// links of the recency list) and an open-addressing index of at least 2N buckets, probed linearly and
+/// compacted on eviction by backward shifting. Links and buckets are node indices of the narrowest type that
+/// fits N (see static_index_t). Nothing is allocated, so the cache can live on the stack or in thread-local
+/// storage, and every operation is constexpr when the Key, Value, HashFunction and KeyEqual are.
+/// The cache is not synchronized.
+class StaticCache
+{
+    static_assert(N > 0 && N < std::numeric_limits<uint32_t>::max(), "StaticCache supports 1 to 2^32-2 pairs");
+
+public:
+    /// \brief index_type   The type of the node indices
+    using index_type = static_index_t<N>;
+
+    constexpr StaticCache()
+        : m_nodes{}, m_buckets{}, m_head(nil), m_tail(nil), m_size(0)
+    {
+        for (auto& bucket : m_buckets) {
+            bucket = nil;
+        }
+    }
+
+    /// \brief size         Returns the amount of inserted key-value pairs
+    constexpr size_t size() const
+    {
+        return m_size;
+    }
+
+    /// \brief capacity     Returns the maximum amount of key-value pairs
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    /// \brief find         Finds the value of corresponding key, if exists, and marks it most recently used
+    /// \param key          The Key
+    /// \return             Returns an std::pair<Value, bool>, see Cache::find
+    constexpr std::pair<Value, bool> find(const Key& key)
+    {
+        auto node = m_buckets[lookup(key)];
+        if (node == nil) {
+            return std::pair<Value, bool>(Value{}, false);
+        }
+        touch(node);
+        return std::pair<Value, bool>(m_nodes[node].value, true);
+    }
+
+    /// \brief insert       Inserts or updates a key-value pair. If the cache is full, the least recently used
+    ///                     pair is evicted.
+    /// \param key          The Key
+    /// \param value        The Value
+    /// \return             0 if Key already existed, 1 if Key is newly added
+    constexpr size_t insert(Key key, Value value)
+    {
+        auto bucket = lookup(key);
+        auto node = m_buckets[bucket];
+        if (node != nil) {
+            m_nodes[node].value = std::move(value);
+            touch(node);
+            return 0;
+        }
+
+        if (m_size < N) {
+            node = static_cast<index_type>(m_size++);
+        }
+        else {
+            node = m_tail;
+            unlink(node);
+            erase_bucket(lookup(m_nodes[node].key));
+            // the erasure may have shifted the probe sequence of the key
+            bucket = lookup(key);
+        }
+        m_nodes[node].key = std::move(key);
+        m_nodes[node].value = std::move(value);
+        m_buckets[bucket] = node;
+        push_front(node);
+        return 1;
+    }
+
+private:
+    /// \brief The node_t struct    A key-value pair and its neighbours in the recency list
+    struct node_t
+    {
+        Key key{};
+        Value value{};
+        /// \brief newer            The next more recently used node, nil for the head
+        index_type newer = 0;
+        /// \brief older            The next less recently used node, nil for the tail
+        index_type older = 0;
+    };
+
+    /// \brief nil                  Marks an empty bucket and the ends of the recency list
+    static constexpr index_type nil = std::numeric_limits<index_type>::max();
+
+    /// \brief bucket_count         The amount of buckets, a power of two of at least 2N
+    static constexpr size_t bucket_count()
+    {
+        size_t buckets = 2;
+        while (buckets < 2 * N) {
+            buckets <<= 1;
+        }
+        return buckets;
+    }
+
+    static constexpr size_t buckets = bucket_count();
+    static constexpr size_t bucket_mask = buckets - 1;
+
+    /// \brief home                 The first bucket probed for a key
+    static constexpr size_t home(const Key& key)
+    {
+        return static_cast<size_t>(mix_hash(HashFunction{}(key))) & bucket_mask;
+    }
+
+    /// \brief lookup               The bucket holding a key, or the empty bucket ending its probe sequence
+    constexpr size_t lookup(const Key& key) const
+    {
+        auto bucket = home(key);
+        while (m_buckets[bucket] != nil && !KeyEqual{}(m_nodes[m_buckets[bucket]].key, key)) {
+            bucket = (bucket + 1) & bucket_mask;
+        }
+        return bucket;
+    }
+
+    /// \brief erase_bucket         Empties a bucket, shifting back the following entries of the cluster that
+    ///                             can move closer to their home, so that no tombstones are needed
+    constexpr void erase_bucket(size_t hole)
+    {
+        auto next = (hole + 1) & bucket_mask;
+        while (m_buckets[next] != nil) {
+            auto distance = (next - home(m_nodes[m_buckets[next]].key)) & bucket_mask;
+            if (distance >= ((next - hole) & bucket_mask)) {
+                m_buckets[hole] = m_buckets[next];
+                hole = next;
+            }
+            next = (next + 1) & bucket_mask;
+        }
+        m_buckets[hole] = nil;
+    }
+
+    /// \brief unlink               Removes a node from the recency list
+    constexpr void unlink(index_type node)
+    {
+        auto& n = m_nodes[node];
+        (n.newer != nil ? m_nodes[n.newer].older : m_head) = n.older;
+        (n.older != nil ? m_nodes[n.older].newer : m_tail) = n.newer;
+    }
+
+    /// \brief push_front           Makes a node the head of the recency list
+    constexpr void push_front(index_type node)
+    {
+        m_nodes[node].newer = nil;
+        m_nodes[node].older = m_head;
+        (m_head != nil ? m_nodes[m_head].newer : m_tail) = node;
+        m_head = node;
+    }
+
+    /// \brief touch                Marks a node most recently used
+    constexpr void touch(index_type node)
+    {
+        if (node != m_head) {
+            unlink(node);
+            push_front(node);
+        }
+    }
+
+    /// \brief m_nodes              The key-value pairs, the first m_size are in use
+    std::array<node_t, N> m_nodes;
+    /// \brief m_buckets            The index, node indices by bucket
+    std::array<index_type, buckets> m_buckets;
+    /// \brief m_head               The most recently used node
+    index_type m_head;
+    /// \brief m_tail               The least recently used node
+    index_type m_tail;
+    /// \brief m_size               The amount of inserted key-value pairs
+    size_t m_size;
+};
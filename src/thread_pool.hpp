@@ -0,0 +1,93 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// \brief The thread_pool_t class A fixed amount of worker threads running submitted tasks in FIFO order.
+/// The amount of threads bounds the amount of tasks running concurrently; further tasks wait in the queue.
+/// The destructor runs the queued tasks to completion before joining the threads.
+class thread_pool_t
+{
+public:
+    /// \brief thread_pool_t        Constructor
+    /// \param threads              The amount of worker threads, at least one
+    explicit thread_pool_t(size_t threads)
+        : m_stop(false)
+    {
+        threads = threads ? threads : 1;
+        for (size_t i = 0; i < threads; i++) {
+            m_workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    /// \brief Disable copy constructor
+    thread_pool_t(const thread_pool_t&) = delete;
+    /// \brief Disable copy assignment operator
+    thread_pool_t& operator=(const thread_pool_t&) = delete;
+
+    ~thread_pool_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    /// \brief threads              The amount of worker threads
+    size_t threads() const
+    {
+        return m_workers.size();
+    }
+
+    /// \brief submit               Queues a task, run by the first idle worker
+    /// \param task                 The task, exceptions thrown by it are ignored
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    /// \brief work                 The loop of a worker thread
+    void work()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            try {
+                task();
+            }
+            catch (...) {
+            }
+        }
+    }
+
+    /// \brief m_tasks              The queued tasks
+    std::deque<std::function<void()>> m_tasks;
+    /// \brief m_stop               Makes the workers exit once the queue is empty
+    bool m_stop;
+    /// \brief m_mutex              Guards m_tasks and m_stop
+    std::mutex m_mutex;
+    /// \brief m_cv                 Wakes the workers up
+    std::condition_variable m_cv;
+    /// \brief m_workers            The worker threads
+    std::vector<std::thread> m_workers;
+};
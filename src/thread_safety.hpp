@@ -1,3 +1,4 @@
+#pragma once
 #include <thread>
 #include <mutex>
 #include <condition_variable>
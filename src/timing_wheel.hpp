@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+template<
+    class Key,
+    class HashFunction=std::hash<Key>,
+    class KeyEqual=std::equal_to<Key>
+>
+/// \brief The timing_wheel_t class Hierarchical timing wheel tracking one deadline (in ticks) per key.
+/// Level l has 64 slots of 64^l ticks each, so 4 levels cover 2^24 ticks; farther deadlines wait in an
+/// overflow list. Scheduling and cancelling are O(1). Advancing the wheel visits one level 0 slot per
+/// elapsed tick and moves a timer down a level at most once per level, so expiring N keys costs O(N)
+/// regardless of the amount of scheduled keys.
+class timing_wheel_t
+{
+public:
+    /// \brief timing_wheel_t       Constructor
+    /// \param now                  The current tick
+    explicit timing_wheel_t(uint64_t now = 0)
+        : m_current(now)
+    {}
+
+    /// \brief size                 The amount of scheduled keys
+    size_t size() const
+    {
+        return m_index.size();
+    }
+
+    /// \brief schedule             Schedules (or reschedules) the expiry of a key
+    /// \param key                  The key
+    /// \param deadline             The tick the key expires at, past deadlines expire on the next tick
+    void schedule(const Key& key, uint64_t deadline)
+    {
+        cancel(key);
+        place(timer_t{key, std::max(deadline, m_current + 1)});
+    }
+
+    /// \brief cancel               Cancels the expiry of a key, if it is scheduled
+    /// \param key                  The key
+    void cancel(const Key& key)
+    {
+        auto item = m_index.find(key);
+        if (item == m_index.end()) {
+            return;
+        }
+        list_at(item->second.list).erase(item->second.timer);
+        m_index.erase(item);
+    }
+
+    /// \brief advance              Advances the wheel and reports every key whose deadline has passed
+    /// \param now                  The current tick
+    /// \param expire               Called once per expired key, after the key has been unscheduled
+    template<class Expire>
+    void advance(uint64_t now, Expire expire)
+    {
+        while (m_current < now) {
+            if (m_index.empty()) {
+                m_current = now;
+                return;
+            }
+            m_current++;
+
+            // cascade the slots whose range starts now, highest level first
+            if ((m_current & overflow_mask) == 0) {
+                replace(m_overflow);
+            }
+            for (size_t level = levels - 1; level > 0; level--) {
+                if ((m_current & ((uint64_t(1) << (slot_bits * level)) - 1)) == 0) {
+                    replace(m_slots[level][slot_of(m_current, level)]);
+                }
+            }
+
+            std::list<timer_t> expired;
+            expired.splice(expired.end(), m_slots[0][slot_of(m_current, 0)]);
+            for (auto& timer : expired) {
+                m_index.erase(timer.key);
+            }
+            for (auto& timer : expired) {
+                expire(timer.key);
+            }
+        }
+    }
+
+private:
+    /// \brief slot_bits            log2 of the amount of slots per level
+    static const size_t slot_bits = 6;
+    /// \brief slots                The amount of slots per level
+    static const size_t slots = size_t(1) << slot_bits;
+    /// \brief levels               The amount of levels
+    static const size_t levels = 4;
+    /// \brief overflow_mask        Ticks covered by all levels minus one
+    static const uint64_t overflow_mask = (uint64_t(1) << (slot_bits * levels)) - 1;
+
+    /// \brief The timer_t struct   A scheduled key
+    struct timer_t
+    {
+        Key key;
+        uint64_t deadline;
+    };
+
+    /// \brief The position_t struct Where a scheduled key is stored. Lists are referred to by id rather than
+    /// by address, so that the wheel stays valid when it is moved or swapped.
+    struct position_t
+    {
+        size_t list;
+        typename std::list<timer_t>::iterator timer;
+    };
+
+    /// \brief overflow_list        The id of the overflow list
+    static const size_t overflow_list = levels * slots;
+
+    /// \brief list_at              The list of a given id, level * slots + slot or overflow_list
+    std::list<timer_t>& list_at(size_t id)
+    {
+        return id == overflow_list ? m_overflow : m_slots[id / slots][id % slots];
+    }
+
+    static size_t slot_of(uint64_t tick, size_t level)
+    {
+        return (tick >> (slot_bits * level)) & (slots - 1);
+    }
+
+    /// \brief place                Stores a timer in the lowest level whose range contains its deadline
+    void place(timer_t timer)
+    {
+        size_t id = overflow_list;
+        for (size_t level = 0; level < levels; level++) {
+            auto range_bits = slot_bits * (level + 1);
+            if ((timer.deadline >> range_bits) == (m_current >> range_bits)) {
+                id = level * slots + slot_of(timer.deadline, level);
+                break;
+            }
+        }
+        auto& list = list_at(id);
+        list.push_back(timer);
+        m_index[timer.key] = position_t{id, std::prev(list.end())};
+    }
+
+    /// \brief replace              Moves all timers of a slot to the levels they now belong to
+    void replace(std::list<timer_t>& list)
+    {
+        std::list<timer_t> timers;
+        timers.splice(timers.end(), list);
+        for (auto& timer : timers) {
+            place(timer);
+        }
+    }
+
+    /// \brief m_slots              The levels of slots
+    std::array<std::array<std::list<timer_t>, slots>, levels> m_slots;
+    /// \brief m_overflow           Timers beyond the range of the top level
+    std::list<timer_t> m_overflow;
+    /// \brief m_index              The Key->position hashmap
+    std::unordered_map<Key, position_t, HashFunction, KeyEqual> m_index;
+    /// \brief m_current            The current tick
+    uint64_t m_current;
+};
@@ -2,6 +2,21 @@
 
 #include "../tests/catch/catch.hpp"
 #include "../src/cache.hpp"
+#include "../src/learned_eviction.hpp"
+#include "../src/adaptive_eviction.hpp"
+#include "../src/set_associative_cache.hpp"
+#include "../src/concurrent_cache.hpp"
+#include "../src/sharded_cache.hpp"
+#include "../src/small_cache.hpp"
+#include "../src/static_cache.hpp"
+#include "../src/compact_cache.hpp"
+#include "../src/direct_mapped_cache.hpp"
+#include "../src/bytes_cache.hpp"
+#include "../src/slab_cache.hpp"
+#include <atomic>
+#include <future>
+#include <random>
+#include <stdexcept>
 #include <tuple>
 
 TEST_CASE("Move construction test") {
@@ -275,3 +290,1694 @@ TEST_CASE("Multithreaded tests") {
     }
 
 }
+
+TEST_CASE("Eviction policy tests") {
+    // Hot keys are re-requested every 160 operations, scan keys are never requested again
+    auto hot_hit_ratio = [](Cache<int, int>& cache) {
+        int scan = 1000000;
+        size_t hits = 0, lookups = 0;
+        for (int round=0; round<1000; round++) {
+            for (int i=0; i<80; i++) {
+                lookups++;
+                if (cache.find(i).second) {
+                    hits++;
+                }
+                else {
+                    cache.insert(i, i);
+                }
+            }
+            for (int i=0; i<80; i++) {
+                cache.insert(scan++, 0);
+            }
+        }
+        return double(hits) / lookups;
+    };
+
+    SECTION("Victims that are not resident fall back to the least recent pair") {
+        /// \brief Selects a Key that is not resident until it is told to forget it
+        struct stale_policy_t : lru_policy_t<int>
+        {
+            void on_erase(const int& key) override
+            {
+                stale = stale && key != -1;
+                lru_policy_t<int>::on_erase(key);
+            }
+
+            int victim() override
+            {
+                return stale ? -1 : lru_policy_t<int>::victim();
+            }
+
+            bool stale = true;
+        };
+        Cache<int, int> cache(10);
+        cache.set_eviction_policy(std::unique_ptr<eviction_policy_t<int>>(new stale_policy_t()));
+        for (int i=0; i<20; i++) {
+            cache.insert(i, i);
+        }
+        REQUIRE(cache.size() == 10);
+        REQUIRE(cache.find(0).second == false);
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.find(19).second == true);
+    }
+    SECTION("Learned policy preserves maximum capacity") {
+        size_t max_size = 10;
+        Cache<int, int> cache(max_size);
+        cache.set_eviction_policy(std::unique_ptr<eviction_policy_t<int>>(new learned_eviction_policy_t<int>()));
+        for (int i=0; i<100; i++) {
+            cache.insert(i, i);
+        }
+        REQUIRE(cache.size() == max_size);
+        REQUIRE(cache.find(99).second == true);
+    }
+    SECTION("Learned policy keeps re-accessed keys under a scan") {
+        Cache<int, int> lru_cache(100);
+        Cache<int, int> learned_cache(100);
+        learned_cache.set_eviction_policy(std::unique_ptr<eviction_policy_t<int>>(new learned_eviction_policy_t<int>()));
+
+        REQUIRE(hot_hit_ratio(lru_cache) < 0.05);
+        REQUIRE(hot_hit_ratio(learned_cache) > 0.2);
+    }
+    SECTION("Classic policies preserve maximum capacity") {
+        for (size_t kind=0; kind<static_cast<size_t>(eviction_policy_kind::count); kind++) {
+            Cache<int, int> cache(10);
+            cache.set_eviction_policy(make_eviction_policy<int, std::hash<int>, std::equal_to<int>>(
+                        eviction_policy_kind(kind), 10));
+            for (int i=0; i<100; i++) {
+                cache.insert(i % 7, i);
+                cache.insert(i, i);
+                cache.find(i / 2);
+            }
+            REQUIRE(cache.size() == 10);
+        }
+    }
+    SECTION("LFU policy keeps frequently used keys") {
+        Cache<int, int> cache(3);
+        cache.set_eviction_policy(make_eviction_policy<int, std::hash<int>, std::equal_to<int>>(
+                    eviction_policy_kind::lfu, 3));
+        cache.insert(1, 1);
+        cache.insert(2, 2);
+        cache.insert(3, 3);
+        cache.find(1);
+        cache.find(1);
+        cache.find(3);
+        cache.insert(4, 4);
+        REQUIRE(cache.find(1).second == true);
+        REQUIRE(cache.find(2).second == false);
+        REQUIRE(cache.find(3).second == true);
+        REQUIRE(cache.find(4).second == true);
+    }
+    SECTION("Adaptive policy switches away from LRU on a frequency-skewed mix") {
+        // Half of the requests go to 50 hot keys, the other half loop over 1000 cold keys
+        auto hit_ratio = [](Cache<int, int>& cache) {
+            std::mt19937 rng(1);
+            size_t hits = 0, lookups = 0;
+            int loop = 0;
+            for (int i=0; i<200000; i++) {
+                int key = rng() % 2 ? int(rng() % 50) : 1000 + loop++ % 1000;
+                lookups++;
+                if (cache.find(key).second) {
+                    hits++;
+                }
+                else {
+                    cache.insert(key, key);
+                }
+            }
+            return double(hits) / lookups;
+        };
+
+        Cache<int, int> lru_cache(100);
+        Cache<int, int> adaptive_cache(100);
+        auto adaptive = new adaptive_eviction_policy_t<int>(100);
+        adaptive_cache.set_eviction_policy(std::unique_ptr<eviction_policy_t<int>>(adaptive));
+
+        auto lru_ratio = hit_ratio(lru_cache);
+        auto adaptive_ratio = hit_ratio(adaptive_cache);
+        REQUIRE(adaptive->live_policy() != eviction_policy_kind::lru);
+        REQUIRE(adaptive_ratio > lru_ratio + 0.1);
+        REQUIRE(adaptive_cache.size() == 100);
+    }
+    SECTION("Resetting the policy restores LRU eviction") {
+        Cache<int, int> cache(3);
+        cache.set_eviction_policy(std::unique_ptr<eviction_policy_t<int>>(new learned_eviction_policy_t<int>()));
+        cache.set_eviction_policy(nullptr);
+        cache.insert(1, 1);
+        cache.insert(2, 2);
+        cache.insert(3, 3);
+        cache.insert(4, 4);
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.find(4).second == true);
+    }
+}
+
+TEST_CASE("Set-associative cache tests") {
+    SECTION("Insert and find") {
+        SetAssociativeCache<int, int> cache(1000);
+        for (int i=0; i<500; i++) {
+            REQUIRE(cache.insert(i, i * 2) == 1);
+        }
+        REQUIRE(cache.insert(7, 70) == 0);
+        REQUIRE(cache.find(7).first == 70);
+        REQUIRE(cache.find(499).first == 998);
+        REQUIRE(cache.find(1000).second == false);
+    }
+    SECTION("Maximum capacity preserved") {
+        SetAssociativeCache<std::string, int, 8> cache(64);
+        for (int i=0; i<1000; i++) {
+            cache.insert(std::to_string(i), i);
+        }
+        REQUIRE(cache.capacity() == 64);
+        REQUIRE(cache.size() == 64);
+    }
+    SECTION("Single set evicts its least recently used way") {
+        SetAssociativeCache<int, int, 16> cache(16);
+        for (int i=0; i<16; i++) {
+            cache.insert(i, i);
+        }
+        cache.find(0);
+        cache.insert(16, 16);
+        REQUIRE(cache.find(0).second == true);
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.find(16).second == true);
+        REQUIRE(cache.size() == 16);
+    }
+    SECTION("Multiple writers and readers") {
+        SetAssociativeCache<int, int> cache(4096);
+        std::vector<std::thread> threads;
+        for (int t=0; t<4; t++) {
+            threads.push_back(std::thread(
+                    [&cache, t]() {
+                        for (int i=t; i<100000; i+=4) {
+                            cache.insert(i, i);
+                            auto res = cache.find(i - 4);
+                            if (res.second && res.first != i - 4) {
+                                throw std::runtime_error("corrupted value");
+                            }
+                        }
+                    }));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        REQUIRE(cache.size() == cache.capacity());
+    }
+}
+
+TEST_CASE("Small cache tests") {
+    SECTION("Insert and find") {
+        SmallCache<int, int, 64> cache;
+        for (int i=0; i<64; i++) {
+            REQUIRE(cache.insert(i, i * 2) == 1);
+        }
+        REQUIRE(cache.insert(7, 70) == 0);
+        REQUIRE(cache.find(7).first == 70);
+        REQUIRE(cache.find(63).first == 126);
+        REQUIRE(cache.find(64).second == false);
+        REQUIRE(cache.size() == 64);
+    }
+    SECTION("The least recently used pair is evicted") {
+        SmallCache<std::string, int, 20> cache;
+        for (int i=0; i<20; i++) {
+            cache.insert(std::to_string(i), i);
+        }
+        cache.find("0");
+        cache.insert("20", 20);
+        REQUIRE(cache.find("0").second == true);
+        REQUIRE(cache.find("1").second == false);
+        cache.insert("21", 21);
+        REQUIRE(cache.find("2").second == false);
+        REQUIRE(cache.find("20").first == 20);
+        REQUIRE(cache.find("21").first == 21);
+        REQUIRE(cache.size() == 20);
+        for (int i=0; i<1000; i++) {
+            cache.insert(std::to_string(i), i);
+        }
+        REQUIRE(cache.size() == 20);
+        for (int i=980; i<1000; i++) {
+            REQUIRE(cache.find(std::to_string(i)).first == i);
+        }
+    }
+    SECTION("Storage is inline") {
+        REQUIRE((sizeof(SmallCache<int, int, 16>) <= 192));
+        REQUIRE((SmallCache<int, int, 8>::capacity() == 8));
+    }
+    SECTION("Multiple writers and readers") {
+        SmallCache<int, int, 32> cache;
+        std::vector<std::thread> threads;
+        for (int t=0; t<4; t++) {
+            threads.push_back(std::thread(
+                    [&cache, t]() {
+                        for (int i=t; i<100000; i+=4) {
+                            cache.insert(i, i);
+                            auto res = cache.find(i - 4);
+                            if (res.second && res.first != i - 4) {
+                                throw std::runtime_error("corrupted value");
+                            }
+                        }
+                    }));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        REQUIRE(cache.size() == cache.capacity());
+    }
+}
+
+/// \brief The constexpr_int_hash struct Hash function usable in constant expressions
+struct constexpr_int_hash
+{
+    constexpr size_t operator() (int key) const
+    {
+        return static_cast<size_t>(key);
+    }
+};
+
+/// \brief static_cache_in_constexpr Runs a StaticCache at compile time
+constexpr int static_cache_in_constexpr()
+{
+    StaticCache<int, int, 4, constexpr_int_hash> cache;
+    for (int i=0; i<6; i++) {
+        cache.insert(i, i * i);
+    }
+    cache.find(2);
+    cache.insert(6, 36);
+    return cache.find(2).first + cache.find(5).first + (cache.find(3).second ? 1000 : 0);
+}
+
+TEST_CASE("Static cache tests") {
+    SECTION("Usable in constant expressions") {
+        static_assert(static_cache_in_constexpr() == 29, "StaticCache must run at compile time");
+        REQUIRE(static_cache_in_constexpr() == 29);
+    }
+    SECTION("Index width follows the capacity") {
+        REQUIRE((std::is_same<StaticCache<int, int, 200>::index_type, uint8_t>::value));
+        REQUIRE((std::is_same<StaticCache<int, int, 1000>::index_type, uint16_t>::value));
+        REQUIRE((std::is_same<StaticCache<int, int, 100000>::index_type, uint32_t>::value));
+        REQUIRE((sizeof(StaticCache<int, int, 64>) <= 64 * 12 + 128 + 16));
+    }
+    SECTION("Behaves like an LRU list") {
+        StaticCache<int, int, 64> cache;
+        std::vector<int> lru;
+        std::mt19937 random(7);
+        for (int i=0; i<5000; i++) {
+            int key = static_cast<int>(random() % 100);
+            auto position = std::find(lru.begin(), lru.end(), key);
+            if (random() % 2) {
+                auto found = cache.find(key);
+                REQUIRE(found.second == (position != lru.end()));
+                if (found.second) {
+                    REQUIRE(found.first == key * 3);
+                    lru.erase(position);
+                    lru.push_back(key);
+                }
+            }
+            else {
+                REQUIRE(cache.insert(key, key * 3) == (position == lru.end() ? 1u : 0u));
+                if (position != lru.end()) {
+                    lru.erase(position);
+                }
+                else if (lru.size() == 64) {
+                    lru.erase(lru.begin());
+                }
+                lru.push_back(key);
+            }
+            REQUIRE(cache.size() == lru.size());
+        }
+    }
+    SECTION("Thread-local memoization") {
+        auto memoized = [](const std::string& s) {
+            thread_local StaticCache<std::string, size_t, 16> cache;
+            auto found = cache.find(s);
+            if (found.second) {
+                return found.first;
+            }
+            cache.insert(s, s.size());
+            return s.size();
+        };
+        REQUIRE(memoized("BTCUSD") == 6);
+        REQUIRE(memoized("BTCUSD") == 6);
+        REQUIRE(memoized("ETH") == 3);
+    }
+}
+
+TEST_CASE("Compact cache tests") {
+    SECTION("Insert and find") {
+        CompactCache<int, int> cache(1000);
+        for (int i=0; i<1000; i++) {
+            REQUIRE(cache.insert(i, i * 2) == 1);
+        }
+        REQUIRE(cache.insert(7, 70) == 0);
+        REQUIRE(cache.find(7).first == 70);
+        REQUIRE(cache.find(999).first == 1998);
+        REQUIRE(cache.find(1000).second == false);
+        REQUIRE(cache.size() == 1000);
+    }
+    SECTION("Least recently used pairs are evicted, unless read since") {
+        CompactCache<std::string, int> cache(3);
+        cache.insert("a", 1);
+        cache.insert("b", 2);
+        cache.insert("c", 3);
+        cache.insert("d", 4);
+        REQUIRE(cache.find("a").second == false);
+        REQUIRE(cache.find("b").first == 2);
+        cache.insert("c", 30);
+        cache.insert("e", 5);
+        // b was read, it is spared once and d is evicted instead
+        REQUIRE(cache.find("d").second == false);
+        REQUIRE(cache.find("b").first == 2);
+        REQUIRE(cache.find("c").first == 30);
+        REQUIRE(cache.find("e").first == 5);
+        REQUIRE(cache.size() == 3);
+    }
+    SECTION("Evictions keep the index consistent") {
+        CompactCache<int, int> cache(100);
+        std::mt19937 random(11);
+        for (int i=0; i<20000; i++) {
+            int key = static_cast<int>(random() % 300);
+            cache.insert(key, key + 1);
+            auto found = cache.find(static_cast<int>(random() % 300));
+            if (found.second) {
+                REQUIRE(found.first > 0);
+            }
+        }
+        REQUIRE(cache.size() == 100);
+        size_t resident = 0;
+        for (int key=0; key<300; key++) {
+            auto found = cache.find(key);
+            if (found.second) {
+                REQUIRE(found.first == key + 1);
+                resident++;
+            }
+        }
+        REQUIRE(resident == 100);
+    }
+    SECTION("Pairs expire after their time-to-live") {
+        CompactCache<int, int> cache(10);
+        cache.insert(1, 1, std::chrono::milliseconds(20));
+        cache.insert(2, 2);
+        REQUIRE(cache.find(1).first == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.find(2).first == 2);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.insert(1, 10, std::chrono::seconds(10)) == 1);
+        REQUIRE(cache.find(1).first == 10);
+    }
+}
+
+/// \brief The date_slot struct Maps days since 2019-01-01, offset by 10000, to their slot
+struct date_slot
+{
+    size_t operator() (int day) const
+    {
+        return static_cast<size_t>(day - 10000);
+    }
+};
+
+TEST_CASE("Direct-mapped cache tests") {
+    SECTION("Insert and find") {
+        DirectMappedCache<uint32_t, int> cache(1000);
+        for (uint32_t i=0; i<1000; i++) {
+            REQUIRE(cache.insert(i, static_cast<int>(i) * 2) == 1);
+        }
+        REQUIRE(cache.insert(7, 70) == 0);
+        REQUIRE(cache.find(7).first == 70);
+        REQUIRE(cache.find(999).first == 1998);
+        REQUIRE(cache.find(1000).second == false);
+        REQUIRE(cache.insert(1000, 1) == 0);
+        REQUIRE(cache.size() == 1000);
+    }
+    SECTION("The resident subset is bounded and evicted in LRU order") {
+        DirectMappedCache<int, std::string, date_slot> cache(365, 3);
+        cache.insert(10000, "a");
+        cache.insert(10001, "b");
+        cache.insert(10002, "c");
+        REQUIRE(cache.find(10000).first == "a");
+        cache.insert(10003, "d");
+        REQUIRE(cache.find(10001).second == false);
+        REQUIRE(cache.find(10000).first == "a");
+        REQUIRE(cache.find(10003).first == "d");
+        REQUIRE(cache.find(9999).second == false);
+        REQUIRE(cache.size() == 3);
+        REQUIRE(cache.capacity() == 3);
+    }
+    SECTION("Multiple writers and readers") {
+        DirectMappedCache<int, int> cache(4096, 1024);
+        std::vector<std::thread> threads;
+        for (int t=0; t<4; t++) {
+            threads.push_back(std::thread(
+                    [&cache, t]() {
+                        for (int i=t; i<100000; i+=4) {
+                            cache.insert(i % 4096, i % 4096);
+                            auto res = cache.find((i - 4) % 4096);
+                            if (res.second && res.first != (i - 4) % 4096) {
+                                throw std::runtime_error("corrupted value");
+                            }
+                        }
+                    }));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        REQUIRE(cache.size() == 1024);
+    }
+}
+
+TEST_CASE("Bytes cache tests") {
+    SECTION("Insert, update and find") {
+        BytesCache<int> cache(1 << 16, 1 << 12);
+        auto pin = cache.pin();
+        REQUIRE(cache.insert(1, "{\"price\": 3.5}") == 1);
+        REQUIRE(cache.insert(2, std::string("\0\1\2", 3)) == 1);
+        REQUIRE(cache.find(1, pin).first == "{\"price\": 3.5}");
+        REQUIRE(cache.find(2, pin).first == std::string("\0\1\2", 3));
+        REQUIRE(cache.insert(1, "{}") == 0);
+        REQUIRE(cache.find(1, pin).first == "{}");
+        REQUIRE(cache.find(3, pin).second == false);
+        REQUIRE(cache.size() == 2);
+    }
+    SECTION("Values longer than a slab are not cached") {
+        BytesCache<int> cache(256, 64);
+        REQUIRE(cache.insert(1, std::string(65, 'x')) == 0);
+        REQUIRE(cache.find(1, cache.pin()).second == false);
+        REQUIRE(cache.insert(1, std::string(64, 'x')) == 1);
+        REQUIRE(cache.insert(2, "small") == 1);
+        REQUIRE(cache.insert(2, std::string(65, 'x')) == 0);
+        REQUIRE(cache.find(2, cache.pin()).second == false);
+        REQUIRE(cache.size() == 1);
+    }
+    SECTION("The oldest slab is evicted") {
+        BytesCache<int> cache(128, 64);
+        for (int i=0; i<12; i++) {
+            cache.insert(i, std::string(16, 'a' + i));
+        }
+        auto pin = cache.pin();
+        REQUIRE(cache.size() == 8);
+        for (int i=0; i<4; i++) {
+            REQUIRE(cache.find(i, pin).second == false);
+        }
+        for (int i=4; i<12; i++) {
+            REQUIRE(cache.find(i, pin).first == std::string(16, 'a' + i));
+        }
+        REQUIRE(cache.memory() == cache.capacity());
+    }
+    SECTION("Pinned views outlive the eviction of their slab") {
+        BytesCache<int> cache(128, 64);
+        for (int i=0; i<8; i++) {
+            cache.insert(i, std::string(16, 'a' + i));
+        }
+        std::string_view view;
+        {
+            auto pin = cache.pin();
+            view = cache.find(0, pin).first;
+            size_t inserted = 0;
+            for (int i=8; i<40; i++) {
+                inserted += cache.insert(i, std::string(16, 'a' + i % 26));
+            }
+            REQUIRE(cache.find(0, pin).second == false);
+            REQUIRE(view == std::string(16, 'a'));
+            // the evicted slab stays in limbo, so insertions are rejected until the pin is released
+            REQUIRE(inserted == 0);
+            REQUIRE(cache.size() == 4);
+            REQUIRE(cache.find(39, pin).second == false);
+            REQUIRE(cache.memory() == cache.capacity());
+        }
+        REQUIRE(cache.insert(39, std::string(16, 'a' + 39 % 26)) == 1);
+        for (int i=0; i<40; i++) {
+            cache.insert(i, std::string(16, 'a' + i % 26));
+        }
+        auto memory = cache.memory();
+        for (int i=0; i<400; i++) {
+            cache.insert(i, std::string(16, 'a' + i % 26));
+        }
+        REQUIRE(cache.memory() == memory);
+    }
+    SECTION("Readers pinning concurrently with a writer") {
+        BytesCache<int> cache(1 << 12, 256);
+        std::atomic<bool> done(false);
+        std::atomic<size_t> corrupted(0);
+        std::vector<std::thread> readers;
+        for (int t=0; t<4; t++) {
+            readers.push_back(std::thread(
+                    [&]() {
+                        while (!done) {
+                            auto pin = cache.pin();
+                            std::vector<std::pair<int, std::string_view>> views;
+                            for (int i=0; i<500; i++) {
+                                auto res = cache.find(i, pin);
+                                if (res.second) {
+                                    views.push_back(std::make_pair(i, res.first));
+                                }
+                            }
+                            for (auto& view : views) {
+                                if (view.second != std::to_string(view.first)) {
+                                    corrupted++;
+                                }
+                            }
+                        }
+                    }));
+        }
+        std::thread writer(
+                [&]() {
+                    for (int round=0; round<100; round++) {
+                        for (int i=0; i<500; i++) {
+                            cache.insert(i, std::to_string(i));
+                        }
+                    }
+                    done = true;
+                });
+        writer.join();
+        for (auto& t : readers) {
+            t.join();
+        }
+        REQUIRE(corrupted == 0);
+        REQUIRE(cache.memory() <= cache.capacity());
+        // insertions rejected while readers held pins succeed once they are gone
+        cache.insert(499, "499");
+        REQUIRE(cache.find(499, cache.pin()).second == true);
+    }
+#if defined(__cpp_lib_span)
+    SECTION("Byte spans") {
+        BytesCache<int> cache(1 << 12, 256);
+        std::byte bytes[] = {std::byte{0x08}, std::byte{0x96}, std::byte{0x01}};
+        REQUIRE(cache.insert(1, std::span<const std::byte>(bytes)) == 1);
+        auto pin = cache.pin();
+        auto res = cache.find_bytes(1, pin);
+        REQUIRE(res.second == true);
+        REQUIRE(res.first.size() == 3);
+        REQUIRE(res.first[1] == std::byte{0x96});
+    }
+#endif
+}
+
+TEST_CASE("Slab cache tests") {
+    const std::chrono::milliseconds manual(0);
+    // Values of these lengths fill the chunks of 64 and 1024 bytes after their item headers
+    const size_t small = 64 - SlabCache<int>::header_size();
+    const size_t large = 1024 - SlabCache<int>::header_size();
+    SECTION("Insert, update and find") {
+        SlabCache<int> cache(1 << 20, 1 << 16, 2.0, manual);
+        REQUIRE(cache.classes() == 11);
+        auto pin = cache.pin();
+        REQUIRE(cache.insert(1, std::string(100, 'a')) == 1);
+        REQUIRE(cache.insert(2, std::string(5000, 'b')) == 1);
+        REQUIRE(cache.find(1, pin).first == std::string(100, 'a'));
+        REQUIRE(cache.find(2, pin).first == std::string(5000, 'b'));
+        REQUIRE(cache.insert(1, "{}") == 0);
+        REQUIRE(cache.find(1, pin).first == "{}");
+        REQUIRE(cache.find(3, pin).second == false);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.stored() == 5002);
+        REQUIRE(cache.pages(2) == 1);
+        REQUIRE(cache.pages(100) == 1);
+        REQUIRE(cache.pages(300) == 0);
+    }
+    SECTION("Values longer than a page are not cached") {
+        SlabCache<int> cache(1 << 16, 1 << 12, 2.0, manual);
+        REQUIRE(cache.insert(1, std::string(4096 - SlabCache<int>::header_size(), 'x')) == 1);
+        REQUIRE(cache.insert(1, std::string(4097 - SlabCache<int>::header_size(), 'x')) == 0);
+        REQUIRE(cache.find(1, cache.pin()).second == false);
+        REQUIRE(cache.size() == 0);
+    }
+    SECTION("Updates that evict the previous Value of their Key do not add it") {
+        SlabCache<int> cache(1 << 12, 1 << 12, 2.0, manual);
+        REQUIRE(cache.insert(1, std::string(large, 'a')) == 1);
+        REQUIRE(cache.insert(1, std::string(large, 'b')) == 0);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.find(1, cache.pin()).first == std::string(large, 'b'));
+    }
+    SECTION("The pages hold the Keys, headers and Values of mixed 100 B to 64 KiB pairs") {
+        SlabCache<int> cache(1 << 26, default_slab_page_size, default_slab_growth_factor, manual);
+        std::mt19937 random(7);
+        std::vector<size_t> lengths(12000);
+        for (int i=0; i<48000; i++) {
+            auto key = i % 12000;
+            // lengths spread evenly over the magnitudes from 100 B to 64 KiB
+            lengths[key] = static_cast<size_t>(100 * std::pow(655.36, std::uniform_real_distribution<>()(random)));
+            cache.insert(key, std::string(lengths[key], 'a' + key % 26));
+            if (i % 500 == 499) {
+                cache.rebalance();
+            }
+        }
+        auto pin = cache.pin();
+        size_t pairs = 0;
+        size_t stored = 0;
+        for (int key=0; key<12000; key++) {
+            auto res = cache.find(key, pin);
+            if (res.second) {
+                REQUIRE(res.first == std::string(lengths[key], 'a' + key % 26));
+                pairs++;
+                stored += lengths[key];
+            }
+        }
+        REQUIRE(cache.size() == pairs);
+        REQUIRE(cache.stored() == stored);
+        auto footprint = stored + pairs * SlabCache<int>::header_size();
+        REQUIRE(footprint <= cache.memory());
+        REQUIRE(cache.memory() <= cache.capacity());
+        INFO("footprint " << footprint << " of " << cache.capacity());
+        REQUIRE(footprint * 10 >= cache.capacity() * 9);
+    }
+    SECTION("Every size class evicts its least recently used pair") {
+        SlabCache<int> cache(1 << 13, 1 << 12, 2.0, manual);
+        for (int i=0; i<64; i++) {
+            REQUIRE(cache.insert(i, std::string(small, 'a')) == 1);
+        }
+        REQUIRE(cache.insert(1000, std::string(4000, 'b')) == 1);
+        REQUIRE(cache.memory() == cache.capacity());
+        cache.find(0, cache.pin());
+        REQUIRE(cache.insert(64, std::string(small, 'a')) == 1);
+        auto pin = cache.pin();
+        REQUIRE(cache.find(0, pin).second == true);
+        REQUIRE(cache.find(1, pin).second == false);
+        REQUIRE(cache.find(64, pin).second == true);
+        REQUIRE(cache.find(1000, pin).second == true);
+        REQUIRE(cache.size() == 65);
+        REQUIRE(cache.insert(2000, std::string(large, 'c')) == 0);
+        REQUIRE(cache.find(2000, pin).second == false);
+    }
+    SECTION("Pages move to the classes under pressure") {
+        SlabCache<int> cache(1 << 14, 1 << 12, 2.0, manual);
+        for (int i=0; i<192; i++) {
+            cache.insert(i, std::string(small, 'a'));
+        }
+        // pages of 16 chunks of 64 bytes take 1 KiB, those of 4 chunks of 1 KiB take 4 KiB
+        REQUIRE(cache.pages(small) == 12);
+        REQUIRE(cache.rebalance() == false);
+        for (int i=0; i<10; i++) {
+            REQUIRE(cache.insert(1000 + i, std::string(large, 'c')) == 1);
+        }
+        REQUIRE(cache.pages(large) == 1);
+        REQUIRE(cache.size() == 192 + 4);
+        // the 6 evicted pairs of 1 KiB take two pages, in place of 8 pages of 64 byte chunks
+        REQUIRE(cache.rebalance() == true);
+        REQUIRE(cache.pages(small) == 4);
+        REQUIRE(cache.pages(large) == 3);
+        REQUIRE(cache.size() == 64 + 4);
+        auto pin = cache.pin();
+        REQUIRE(cache.find(0, pin).second == false);
+        REQUIRE(cache.find(191, pin).second == true);
+        for (int i=10; i<18; i++) {
+            REQUIRE(cache.insert(1000 + i, std::string(large, 'c')) == 1);
+        }
+        REQUIRE(cache.size() == 64 + 12);
+        REQUIRE(cache.rebalance() == false);
+        REQUIRE(cache.memory() == cache.capacity());
+    }
+    SECTION("Pages whose pairs fit the free chunks of their class move without evictions") {
+        SlabCache<int> cache(1 << 14, 1 << 12, 2.0, manual);
+        const size_t medium = 128 - SlabCache<int>::header_size();
+        for (int i=0; i<192; i++) {
+            cache.insert(i, std::string(small, 'a' + i % 26));
+        }
+        for (int i=0; i<32; i++) {
+            cache.insert(1000 + i, std::string(medium, 'b'));
+        }
+        REQUIRE(cache.memory() == cache.capacity());
+        // Values longer than a page remove the odd Keys of the first 4 pages
+        for (int i=1; i<64; i+=2) {
+            REQUIRE(cache.insert(i, std::string(5000, 'x')) == 0);
+        }
+        REQUIRE(cache.insert(1032, std::string(medium, 'b')) == 1);
+        REQUIRE(cache.rebalance() == true);
+        REQUIRE(cache.pages(small) == 10);
+        REQUIRE(cache.pages(medium) == 3);
+        REQUIRE(cache.size() == 160 + 32);
+        auto pin = cache.pin();
+        for (int i=0; i<192; i++) {
+            if (i >= 64 || i % 2 == 0) {
+                REQUIRE(cache.find(i, pin).first == std::string(small, 'a' + i % 26));
+            }
+        }
+        REQUIRE(cache.memory() == cache.capacity());
+    }
+    SECTION("Pinned views outlive the reuse of their chunks and pages") {
+        SlabCache<int> cache(1 << 14, 1 << 12, 2.0, manual);
+        for (int i=0; i<192; i++) {
+            cache.insert(i, std::string(small, 'a' + i % 26));
+        }
+        {
+            auto pin = cache.pin();
+            auto view = cache.find(0, pin).first;
+            auto updated = cache.find(191, pin).first;
+            cache.insert(191, std::string(small, 'z'));
+            for (int i=0; i<20; i++) {
+                cache.insert(1000 + i, std::string(large, 'c'));
+            }
+            REQUIRE(cache.rebalance() == true);
+            REQUIRE(cache.find(0, pin).second == false);
+            REQUIRE(cache.pages(large) == 0);
+            REQUIRE(cache.pages(small) == 1);
+            REQUIRE(view == std::string(small, 'a'));
+            REQUIRE(updated == std::string(small, 'a' + 191 % 26));
+        }
+        // the 12 freed pages of 1 KiB make room for three pages of 4 KiB
+        REQUIRE(cache.insert(1000, std::string(large, 'c')) == 1);
+        REQUIRE(cache.pages(large) == 3);
+        REQUIRE(cache.memory() == (1 << 10) + 3 * (1 << 12));
+    }
+    SECTION("The rebalancer runs in the background") {
+        SlabCache<int> cache(1 << 14, 1 << 12, 2.0, std::chrono::milliseconds(1));
+        for (int i=0; i<256; i++) {
+            cache.insert(i, std::string(small, 'a'));
+        }
+        for (int round=0; round<1000 && cache.pages(large) == 0; round++) {
+            cache.insert(1000, std::string(large, 'c'));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(cache.pages(large) == 1);
+        cache.insert(1000, std::string(large, 'c'));
+        REQUIRE(cache.find(1000, cache.pin()).second == true);
+    }
+    SECTION("Concurrent readers and writers") {
+        SlabCache<int> cache(1 << 16, 1 << 12, 1.25, std::chrono::milliseconds(1));
+        std::atomic<size_t> corrupted(0);
+        std::vector<std::thread> threads;
+        for (int t=0; t<4; t++) {
+            threads.push_back(std::thread(
+                    [&cache, &corrupted, t]() {
+                        for (int i=t; i<20000; i+=4) {
+                            auto key = i % 512;
+                            cache.insert(key, std::string(key * 7 % 4000 + 1, 'a' + key % 26));
+                            auto pin = cache.pin();
+                            auto next = (key + 1) % 512;
+                            auto res = cache.find(next, pin);
+                            if (res.second && res.first != std::string(next * 7 % 4000 + 1, 'a' + next % 26)) {
+                                corrupted++;
+                            }
+                        }
+                    }));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        REQUIRE(corrupted == 0);
+        REQUIRE(cache.memory() <= cache.capacity());
+    }
+}
+
+/// \brief The two_ints_t struct Trivially copyable value whose halves must always match
+struct two_ints_t
+{
+    int first;
+    int second;
+};
+
+TEST_CASE("Concurrent cuckoo cache tests") {
+    SECTION("Insert, update and find") {
+        ConcurrentCache<int, int> cache(1000);
+        for (int i=0; i<1000; i++) {
+            REQUIRE(cache.insert(i, i * 2) == 1);
+        }
+        REQUIRE(cache.insert(7, 70) == 0);
+        REQUIRE(cache.size() == 1000);
+        REQUIRE(cache.find(7).first == 70);
+        for (int i=8; i<1000; i++) {
+            REQUIRE(cache.find(i).first == i * 2);
+        }
+        REQUIRE(cache.find(1000).second == false);
+    }
+    SECTION("Maximum capacity preserved") {
+        ConcurrentCache<int, int> cache(100);
+        for (int i=0; i<10000; i++) {
+            cache.insert(i, i);
+        }
+        REQUIRE(cache.size() == 100);
+        REQUIRE(cache.find(9999).second == true);
+    }
+    SECTION("CLOCK spares referenced keys") {
+        ConcurrentCache<int, int> cache(8);
+        for (int i=0; i<8; i++) {
+            cache.insert(i, i);
+        }
+        cache.find(0);
+        cache.insert(8, 8);
+        REQUIRE(cache.find(0).second == true);
+        REQUIRE(cache.find(8).second == true);
+        REQUIRE(cache.size() == 8);
+    }
+    SECTION("Snapshots copy every pair") {
+        ConcurrentCache<int, double> cache(500);
+        for (int i=0; i<1000; i++) {
+            cache.insert(i, i / 2.0);
+        }
+        std::vector<int> keys;
+        std::vector<double> values;
+        REQUIRE(cache.snapshot(keys, values) == 500);
+        REQUIRE(values.size() == 500);
+        for (size_t i=0; i<keys.size(); i++) {
+            REQUIRE(values[i] == keys[i] / 2.0);
+            REQUIRE(cache.find(keys[i]).second == true);
+        }
+        std::sort(keys.begin(), keys.end());
+        REQUIRE(std::unique(keys.begin(), keys.end()) == keys.end());
+    }
+    SECTION("Readers never observe torn values") {
+        ConcurrentCache<int, two_ints_t> cache(1000);
+        std::atomic<bool> done(false);
+        std::atomic<size_t> torn(0);
+        std::vector<std::thread> readers;
+        for (int t=0; t<4; t++) {
+            readers.push_back(std::thread(
+                    [&]() {
+                        while (!done) {
+                            for (int i=0; i<2000; i++) {
+                                auto res = cache.find(i);
+                                if (res.second && (res.first.first != i || res.first.second != -i)) {
+                                    torn++;
+                                }
+                            }
+                        }
+                    }));
+        }
+        std::thread writer(
+                [&]() {
+                    for (int round=0; round<50; round++) {
+                        for (int i=0; i<2000; i++) {
+                            cache.insert(i, two_ints_t{i, -i});
+                        }
+                    }
+                    done = true;
+                });
+        writer.join();
+        for (auto& t : readers) {
+            t.join();
+        }
+        REQUIRE(torn == 0);
+        REQUIRE(cache.size() == 1000);
+    }
+}
+
+/// \brief The string_length_weigher struct Weighs pairs by the length of their string value
+struct string_length_weigher
+{
+    size_t operator() (int, const std::string& value) const
+    {
+        return value.size();
+    }
+};
+
+TEST_CASE("Weighted capacity tests") {
+    using weighted_cache_t = Cache<int, std::string, std::hash<int>, std::equal_to<int>,
+                                   std::allocator<std::pair<const int, std::string>>, string_length_weigher>;
+
+    SECTION("Maximum weight preserved") {
+        weighted_cache_t cache(100);
+        cache.set_max_weight(10);
+        cache.insert(1, "aaaa");
+        cache.insert(2, "bbbb");
+        REQUIRE(cache.weight() == 8);
+        cache.insert(3, "cccc");
+        REQUIRE(cache.weight() == 8);
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.find(2).second == true);
+        REQUIRE(cache.find(3).second == true);
+    }
+    SECTION("Eviction continues until the new pair fits") {
+        weighted_cache_t cache(100);
+        cache.set_max_weight(10);
+        cache.insert(1, "aaa");
+        cache.insert(2, "bbb");
+        cache.insert(3, "ccc");
+        cache.insert(4, "dddddddddd");
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.weight() == 10);
+        REQUIRE(cache.find(4).second == true);
+    }
+    SECTION("Pairs heavier than the maximum weight are rejected") {
+        weighted_cache_t cache(100);
+        cache.set_max_weight(10);
+        cache.insert(1, "aaa");
+        REQUIRE(cache.insert(2, "bbbbbbbbbbb") == 0);
+        REQUIRE(cache.find(2).second == false);
+        REQUIRE(cache.find(1).second == true);
+        REQUIRE(cache.weight() == 3);
+    }
+    SECTION("Lowering the maximum weight evicts") {
+        weighted_cache_t cache(100);
+        for (int i=0; i<10; i++) {
+            cache.insert(i, "xx");
+        }
+        REQUIRE(cache.weight() == 20);
+        cache.set_max_weight(5);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.find(9).second == true);
+    }
+}
+
+TEST_CASE("Expiration tests") {
+    SECTION("Timing wheel expires keys at their deadline") {
+        timing_wheel_t<int> wheel(0);
+        wheel.schedule(1, 5);
+        wheel.schedule(2, 100);
+        wheel.schedule(3, 5000);
+        wheel.schedule(4, 300000);
+        wheel.schedule(5, 40000000);
+        wheel.schedule(6, 70);
+        wheel.cancel(6);
+
+        std::vector<int> expired;
+        auto collect = [&expired](int key) { expired.push_back(key); };
+        wheel.advance(4, collect);
+        REQUIRE(expired.empty());
+        wheel.advance(5, collect);
+        REQUIRE(expired == std::vector<int>{1});
+        wheel.advance(4999, collect);
+        REQUIRE(expired == std::vector<int>({1, 2}));
+        wheel.advance(300000, collect);
+        REQUIRE(expired == std::vector<int>({1, 2, 3, 4}));
+        REQUIRE(wheel.size() == 1);
+        wheel.advance(40000000, collect);
+        REQUIRE(expired == std::vector<int>({1, 2, 3, 4, 5}));
+        REQUIRE(wheel.size() == 0);
+    }
+    SECTION("Expired pairs are not found") {
+        Cache<int, int> cache(10);
+        cache.insert(1, 1, std::chrono::milliseconds(50));
+        cache.insert(2, 2);
+        REQUIRE(cache.find(1).second == true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.find(2).second == true);
+        REQUIRE(cache.size() == 1);
+    }
+    SECTION("Expired pairs are reclaimed by the maintenance") {
+        Cache<int, int> cache(1000);
+        for (int i=0; i<500; i++) {
+            cache.insert(i, i, std::chrono::milliseconds(20));
+        }
+        cache.insert(1000, 1000, std::chrono::hours(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cache.run_maintenance();
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.find(1000).second == true);
+    }
+    SECTION("Expired pairs are evicted before live ones") {
+        Cache<int, int> cache(3);
+        cache.insert(1, 1);
+        cache.insert(2, 2, std::chrono::milliseconds(20));
+        cache.insert(3, 3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cache.insert(4, 4);
+        REQUIRE(cache.find(1).second == true);
+        REQUIRE(cache.find(3).second == true);
+        REQUIRE(cache.find(4).second == true);
+    }
+    SECTION("Coarse clock follows the steady clock") {
+        auto coarse = coarse_clock_t::now();
+        auto steady = std::chrono::steady_clock::now();
+        REQUIRE(steady - coarse < std::chrono::milliseconds(20));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        REQUIRE(coarse_clock_t::now() - coarse >= std::chrono::milliseconds(10));
+    }
+    SECTION("Idle pairs expire, read pairs stay") {
+        Cache<int, int> cache(10);
+        cache.set_time_to_idle(std::chrono::milliseconds(60));
+        cache.insert(1, 1);
+        cache.insert(2, 2);
+        for (int i=0; i<5; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            REQUIRE(cache.find(1).second == true);
+        }
+        REQUIRE(cache.find(2).second == false);
+        REQUIRE(cache.size() == 1);
+    }
+    SECTION("Idle pairs are reclaimed by the maintenance") {
+        Cache<int, int> cache(1000);
+        cache.set_time_to_idle(std::chrono::milliseconds(60));
+        for (int i=0; i<100; i++) {
+            cache.insert(i, i);
+        }
+        for (int i=0; i<5; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            cache.find(0);
+            cache.run_maintenance();
+        }
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.find(0).second == true);
+    }
+    SECTION("An expired key can be inserted again") {
+        Cache<int, int> cache(3);
+        cache.insert(1, 1, std::chrono::milliseconds(20));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(cache.insert(1, 2) == 1);
+        REQUIRE(cache.find(1).first == 2);
+    }
+}
+
+TEST_CASE("Refresh-ahead tests") {
+    SECTION("Stale pairs are served while being reloaded once") {
+        Cache<int, int> cache(10);
+        std::atomic<int> loads(0);
+        cache.set_loader([&loads](const int& key) {
+            loads++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return key * 10;
+        });
+        cache.set_refresh_after(std::chrono::milliseconds(20));
+        cache.insert(1, 1);
+        REQUIRE(cache.find(1).first == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        for (int i=0; i<100; i++) {
+            REQUIRE(cache.find(1).second == true);
+        }
+        int value = 0;
+        for (int i=0; i<100 && value != 10; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            value = cache.find(1).first;
+        }
+        REQUIRE(value == 10);
+        REQUIRE(loads == 1);
+    }
+    SECTION("A refresh restarts the time-to-live") {
+        Cache<int, int> cache(10);
+        cache.set_loader([](const int& key) { return key; });
+        cache.set_refresh_after(std::chrono::milliseconds(30));
+        cache.insert(1, 1, std::chrono::milliseconds(80));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(cache.find(1).second == true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        REQUIRE(cache.find(1).second == true);
+    }
+    SECTION("A failed reload keeps the current value") {
+        Cache<int, int> cache(10);
+        cache.set_loader([](const int&) -> int { throw std::runtime_error("backend down"); });
+        cache.set_refresh_after(std::chrono::milliseconds(1));
+        cache.insert(1, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(cache.find(1).first == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(cache.find(1).first == 1);
+    }
+}
+
+TEST_CASE("Early recomputation tests") {
+    SECTION("Pairs reclaimed by the maintenance of their own insertion") {
+        Cache<int, int> cache(10000);
+        for (int i=0; i<static_cast<int>(default_maintenance_interval) * 5; i++) {
+            REQUIRE(cache.insert(i, i, std::chrono::nanoseconds::zero(), std::chrono::milliseconds(1)) == 1);
+        }
+        REQUIRE(cache.find(0).second == false);
+    }
+    SECTION("Exactly one caller recomputes ahead of the expiration") {
+        Cache<int, int> cache(10);
+        cache.set_early_recomputation(1.0);
+        cache.insert(1, 1, std::chrono::milliseconds(100), std::chrono::milliseconds(50));
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(80);
+        std::atomic<int> misses(0);
+        std::vector<std::thread> readers;
+        for (int t=0; t<4; t++) {
+            readers.emplace_back([&cache, &misses, deadline]() {
+                while (std::chrono::steady_clock::now() < deadline) {
+                    if (!cache.find(1).second) {
+                        misses++;
+                    }
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        REQUIRE(misses == 1);
+        REQUIRE(cache.insert(1, 2, std::chrono::seconds(10)) == 0);
+        REQUIRE(cache.find(1).first == 2);
+    }
+    SECTION("Pairs far from their expiration are not recomputed") {
+        Cache<int, int> cache(10);
+        cache.set_early_recomputation(1.0);
+        cache.insert(1, 1, std::chrono::seconds(10), std::chrono::milliseconds(1));
+        for (int i=0; i<1000; i++) {
+            REQUIRE(cache.find(1).second == true);
+        }
+    }
+    SECTION("Loads after an early miss keep the time-to-live") {
+        Cache<int, int> cache(10);
+        cache.set_early_recomputation(1.0);
+        // a recomputation far longer than the time-to-live makes the first read an early miss
+        cache.insert(1, 1, std::chrono::milliseconds(100), std::chrono::hours(1));
+        REQUIRE(cache.get_or_load(1, [](const int&) { return 2; }) == 2);
+        REQUIRE(cache.find(1).first == 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        REQUIRE(cache.find(1).second == false);
+    }
+    SECTION("Disabled by default") {
+        Cache<int, int> cache(10);
+        cache.insert(1, 1, std::chrono::milliseconds(50), std::chrono::seconds(10));
+        REQUIRE(cache.find(1).second == true);
+    }
+}
+
+TEST_CASE("Loading cache tests") {
+    SECTION("Concurrent misses run the loader once") {
+        Cache<int, int> cache(10);
+        std::atomic<int> loads(0);
+        auto loader = [&loads](const int& key) {
+            loads++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            return key * 10;
+        };
+        std::vector<std::thread> callers;
+        std::atomic<int> correct(0);
+        for (int t=0; t<8; t++) {
+            callers.emplace_back([&cache, &loader, &correct]() {
+                if (cache.get_or_load(1, loader) == 10) {
+                    correct++;
+                }
+            });
+        }
+        for (auto& caller : callers) {
+            caller.join();
+        }
+        REQUIRE(loads == 1);
+        REQUIRE(correct == 8);
+        REQUIRE(cache.find(1).first == 10);
+        REQUIRE(cache.get_or_load(1, loader) == 10);
+        REQUIRE(loads == 1);
+    }
+    SECTION("A failed load is not cached") {
+        Cache<int, int> cache(10);
+        REQUIRE_THROWS_AS(cache.get_or_load(1, [](const int&) -> int { throw std::runtime_error("backend down"); }),
+                          const std::runtime_error&);
+        REQUIRE(cache.find(1).second == false);
+        REQUIRE(cache.get_or_load(1, [](const int& key) { return key + 1; }) == 2);
+        REQUIRE(cache.size() == 1);
+    }
+    SECTION("Asynchronous loads are inserted on completion") {
+        Cache<int, int> cache(10);
+        cache.set_loader([](const int& key) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return key * 10;
+        });
+        auto first = cache.get_async(1);
+        auto second = cache.get_async(1);
+        REQUIRE(first.get() == 10);
+        REQUIRE(second.get() == 10);
+        REQUIRE(cache.find(1).first == 10);
+        auto hit = cache.get_async(1);
+        REQUIRE(hit.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        REQUIRE(hit.get() == 10);
+    }
+    SECTION("Loader threads bound the concurrent loads") {
+        Cache<int, int> cache(100);
+        cache.set_loader_threads(2);
+        std::atomic<int> running(0);
+        std::atomic<int> peak(0);
+        cache.set_loader([&running, &peak](const int& key) {
+            auto now = ++running;
+            auto seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            running--;
+            return key;
+        });
+        std::vector<std::shared_future<int>> results;
+        for (int i=0; i<8; i++) {
+            results.push_back(cache.get_async(i));
+        }
+        for (int i=0; i<8; i++) {
+            REQUIRE(results[i].get() == i);
+        }
+        REQUIRE(peak <= 2);
+        REQUIRE(cache.size() == 8);
+    }
+    SECTION("A failed asynchronous load is reported through the future") {
+        Cache<int, int> cache(10);
+        cache.set_loader([](const int&) -> int { throw std::runtime_error("backend down"); });
+        REQUIRE_THROWS_AS(cache.get_async(1).get(), const std::runtime_error&);
+        REQUIRE(cache.size() == 0);
+    }
+}
+
+#if defined(__cpp_impl_coroutine)
+/// \brief The detached_task_t struct Coroutine that starts eagerly and is never awaited
+struct detached_task_t
+{
+    struct promise_type
+    {
+        detached_task_t get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached_task_t await_value(Cache<int, int>& cache, int key, std::atomic<int>& sum, std::atomic<int>& done)
+{
+    sum += co_await cache.get(key);
+    done++;
+}
+
+detached_task_t await_failure(Cache<int, int>& cache, int key, std::atomic<int>& failures)
+{
+    try {
+        co_await cache.get(key);
+    }
+    catch (const std::runtime_error&) {
+        failures++;
+    }
+}
+
+/// \brief The counted_key_t struct Key that counts its copies
+struct counted_key_t
+{
+    counted_key_t() : id(0) {}
+    explicit counted_key_t(int id) : id(id) {}
+    counted_key_t(const counted_key_t& other) : id(other.id) { copies++; }
+    counted_key_t& operator=(const counted_key_t& other) { id = other.id; copies++; return *this; }
+    bool operator==(const counted_key_t& other) const { return id == other.id; }
+
+    int id;
+    static int copies;
+};
+
+int counted_key_t::copies = 0;
+
+/// \brief The counted_key_hash struct Hash function of counted_key_t
+struct counted_key_hash
+{
+    size_t operator() (const counted_key_t& key) const
+    {
+        return std::hash<int>{}(key.id);
+    }
+};
+
+TEST_CASE("Coroutine lookup tests") {
+    SECTION("A hit completes without suspending") {
+        Cache<int, int> cache(10);
+        cache.insert(1, 5);
+        std::atomic<int> sum(0);
+        std::atomic<int> done(0);
+        await_value(cache, 1, sum, done);
+        REQUIRE(done == 1);
+        REQUIRE(sum == 5);
+    }
+    SECTION("A hit does not copy the Key") {
+        Cache<counted_key_t, int, counted_key_hash> cache(10);
+        cache.insert(counted_key_t(1), 5);
+        counted_key_t::copies = 0;
+        int value = 0;
+        [](Cache<counted_key_t, int, counted_key_hash>& cache, int& value) -> detached_task_t {
+            value = co_await cache.get(counted_key_t(1));
+        }(cache, value);
+        REQUIRE(value == 5);
+        REQUIRE(counted_key_t::copies == 0);
+    }
+    SECTION("Suspended coroutines share one load") {
+        Cache<int, int> cache(10);
+        std::atomic<int> loads(0);
+        cache.set_loader([&loads](const int& key) {
+            loads++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return key * 10;
+        });
+        std::atomic<int> sum(0);
+        std::atomic<int> done(0);
+        for (int i=0; i<100; i++) {
+            await_value(cache, 1, sum, done);
+        }
+        for (int i=0; i<200 && done != 100; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(done == 100);
+        REQUIRE(sum == 1000);
+        REQUIRE(loads == 1);
+    }
+    SECTION("Coroutines are resumed on the given executor") {
+        Cache<int, int> cache(10);
+        cache.set_loader([](const int& key) { return key; });
+        std::atomic<int> resumed(0);
+        std::atomic<int> value(0);
+        [](Cache<int, int>& cache, std::atomic<int>& resumed, std::atomic<int>& value) -> detached_task_t {
+            value = co_await cache.get(7, [&resumed](std::function<void()> task) {
+                resumed++;
+                task();
+            });
+        }(cache, resumed, value);
+        for (int i=0; i<200 && value != 7; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(value == 7);
+        REQUIRE(resumed == 1);
+    }
+    SECTION("A failed load throws in the coroutine") {
+        Cache<int, int> cache(10);
+        cache.set_loader([](const int&) -> int { throw std::runtime_error("backend down"); });
+        std::atomic<int> failures(0);
+        await_failure(cache, 1, failures);
+        for (int i=0; i<200 && failures != 1; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        REQUIRE(failures == 1);
+        REQUIRE(cache.size() == 0);
+    }
+}
+#endif
+
+TEST_CASE("Batch tests") {
+    std::vector<int> keys;
+    std::vector<int> values;
+    for (int i=0; i<200; i++) {
+        keys.push_back(i * 7);
+        values.push_back(i);
+    }
+    SECTION("multi_find reports hits and misses in the bitmap") {
+        Cache<int, int> cache(1000);
+        REQUIRE(cache.multi_insert(keys.data(), values.data(), 100) == 100);
+        REQUIRE(cache.multi_insert(keys.data(), values.data(), 100) == 0);
+        std::vector<int> found_values(200, -1);
+        std::vector<uint64_t> found(4, ~uint64_t(0));
+        cache.multi_find(keys.data(), keys.size(), found_values.data(), found.data());
+        for (int i=0; i<200; i++) {
+            bool hit = (found[i / 64] >> (i % 64)) & 1;
+            REQUIRE(hit == (i < 100));
+            REQUIRE(found_values[i] == (i < 100 ? i : -1));
+        }
+    }
+    SECTION("Prefetched groups match single lookups") {
+        // 37 keys are two full groups of 16 and a partial one of 5
+        Cache<int, int> cache(1000);
+        REQUIRE(cache.multi_insert(keys.data(), values.data(), 150) == 150);
+        std::vector<size_t> indices;
+        for (size_t i=0; i<37; i++) {
+            indices.push_back(i * 5);
+        }
+        std::vector<int> found_values(keys.size(), -1);
+        std::vector<uint64_t> found(4);
+        cache.multi_find(keys.data(), indices.size(), found_values.data(), found.data(), indices.data());
+        for (auto i : indices) {
+            auto single = cache.find(keys[i]);
+            REQUIRE(bool((found[i / 64] >> (i % 64)) & 1) == single.second);
+            REQUIRE(single.second == (i < 150));
+            REQUIRE(found_values[i] == (single.second ? single.first : -1));
+        }
+        found_values.assign(37, -1);
+        cache.multi_find(keys.data() + 130, 37, found_values.data(), found.data());
+        for (size_t i=0; i<37; i++) {
+            auto single = cache.find(keys[130 + i]);
+            REQUIRE(bool((found[i / 64] >> (i % 64)) & 1) == single.second);
+            REQUIRE(found_values[i] == (single.second ? single.first : -1));
+        }
+    }
+    SECTION("Sharded batches match single lookups") {
+        ShardedCache<int, int> cache(1000, 8);
+        REQUIRE(cache.shards() == 8);
+        REQUIRE(cache.multi_insert(keys.data(), values.data(), keys.size()) == 200);
+        REQUIRE(cache.size() == 200);
+        cache.insert(-1, -1);
+        keys.push_back(-2);
+        std::vector<int> found_values(keys.size());
+        std::vector<uint64_t> found(4);
+        cache.multi_find(keys.data(), keys.size(), found_values.data(), found.data());
+        for (size_t i=0; i<keys.size(); i++) {
+            auto single = cache.find(keys[i]);
+            REQUIRE(bool((found[i / 64] >> (i % 64)) & 1) == single.second);
+            if (single.second) {
+                REQUIRE(found_values[i] == single.first);
+            }
+        }
+        REQUIRE(cache.find(-1).first == -1);
+    }
+    SECTION("Sharded capacity is split without exceeding the maximum") {
+        ShardedCache<int, int> uneven(100, 16);
+        ShardedCache<int, int> tiny(10, 16);
+        REQUIRE(tiny.shards() == 10);
+        for (int i=0; i<10000; i++) {
+            uneven.insert(i, i);
+            tiny.insert(i, i);
+        }
+        REQUIRE(uneven.size() == 100);
+        REQUIRE(tiny.size() == 10);
+    }
+#if defined(__cpp_lib_span)
+    SECTION("Span batches reject short outputs") {
+        Cache<int, int> cache(1000);
+        ShardedCache<int, int> sharded(1000, 8);
+        std::vector<int> short_values(199);
+        std::vector<uint64_t> found(4);
+        std::vector<uint64_t> short_found(3);
+        REQUIRE_THROWS_AS(cache.multi_find(std::span<const int>(keys), std::span<int>(short_values),
+                                           std::span<uint64_t>(found)), const std::length_error&);
+        REQUIRE_THROWS_AS(sharded.multi_find(std::span<const int>(keys), std::span<int>(values),
+                                             std::span<uint64_t>(short_found)), const std::length_error&);
+        REQUIRE_THROWS_AS(cache.multi_insert(std::span<const int>(keys), std::span<const int>(short_values)),
+                          const std::length_error&);
+        REQUIRE_THROWS_AS(sharded.multi_insert(std::span<const int>(keys), std::span<const int>(short_values)),
+                          const std::length_error&);
+        REQUIRE(sharded.multi_insert(std::span<const int>(keys), std::span<const int>(values)) == 200);
+        sharded.multi_find(std::span<const int>(keys), std::span<int>(values), std::span<uint64_t>(found));
+        REQUIRE(found[3] == (uint64_t(1) << 8) - 1);
+    }
+#endif
+}
+
+TEST_CASE("Batch hashing tests") {
+    std::mt19937_64 random(7);
+    std::vector<uint64_t> words(1000);
+    for (auto& word : words) {
+        word = random();
+    }
+    SECTION("Batch kernels match mix_hash") {
+        for (size_t count : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(13), size_t(16), size_t(23),
+                             size_t(1000)}) {
+            std::vector<uint64_t> hashes(count);
+            mix_hash_batch(words.data(), count, hashes.data());
+            for (size_t i=0; i<count; i++) {
+                REQUIRE(hashes[i] == mix_hash(words[i]));
+            }
+#if defined(CACHE_HASH_DISPATCH)
+            if (__builtin_cpu_supports("avx2")) {
+                std::vector<uint64_t> avx2(count);
+                mix_hash_batch_avx2(words.data(), count, avx2.data());
+                REQUIRE(avx2 == hashes);
+            }
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+                std::vector<uint64_t> avx512(count);
+                mix_hash_batch_avx512(words.data(), count, avx512.data());
+                REQUIRE(avx512 == hashes);
+            }
+#endif
+        }
+    }
+    SECTION("fixed_width_hash batches match single keys") {
+        std::vector<int> keys(100);
+        for (size_t i=0; i<keys.size(); i++) {
+            keys[i] = static_cast<int>(random()) - 1000 * static_cast<int>(i);
+        }
+        std::vector<uint64_t> hashes(keys.size());
+        fixed_width_hash::hash_batch(keys.data(), keys.size(), hashes.data());
+        for (size_t i=0; i<keys.size(); i++) {
+            REQUIRE(hashes[i] == fixed_width_hash{}(keys[i]));
+        }
+        REQUIRE((has_hash_batch<fixed_width_hash, int>::value));
+        REQUIRE(!(has_hash_batch<std::hash<int>, int>::value));
+    }
+    SECTION("Cache batches of batch-hashed keys match single lookups") {
+        Cache<uint64_t, uint64_t, fixed_width_hash> cache(2000);
+        std::vector<size_t> indices;
+        for (size_t i=0; i<words.size(); i+=3) {
+            indices.push_back(i);
+        }
+        REQUIRE(cache.multi_insert(words.data(), words.data(), 101, indices.data()) == 101);
+        std::vector<uint64_t> values(words.size());
+        std::vector<uint64_t> found((words.size() + 63) / 64);
+        cache.multi_find(words.data(), words.size(), values.data(), found.data());
+        for (size_t i=0; i<words.size(); i++) {
+            bool inserted = i % 3 == 0 && i / 3 < 101;
+            REQUIRE(bool((found[i / 64] >> (i % 64)) & 1) == inserted);
+            REQUIRE(cache.find(words[i]).second == inserted);
+            if (inserted) {
+                REQUIRE(values[i] == words[i]);
+            }
+        }
+    }
+    SECTION("Sharded batches of batch-hashed keys match single lookups") {
+        ShardedCache<uint64_t, uint64_t, fixed_width_hash> cache(2000, 4);
+        REQUIRE(cache.multi_insert(words.data(), words.data(), 500) == 500);
+        std::vector<uint64_t> values(words.size());
+        std::vector<uint64_t> found((words.size() + 63) / 64);
+        cache.multi_find(words.data(), words.size(), values.data(), found.data());
+        for (size_t i=0; i<words.size(); i++) {
+            REQUIRE(bool((found[i / 64] >> (i % 64)) & 1) == (i < 500));
+            REQUIRE(cache.find(words[i]).second == (i < 500));
+        }
+    }
+}
+
+TEST_CASE("Hashed key tests") {
+    SECTION("Pair hashes are asymmetric and do not cancel out") {
+        cache_key_hash_function hash;
+        auto a = hash(std::make_pair(std::string("ETHBTC"), std::string("BTCETH")));
+        auto b = hash(std::make_pair(std::string("BTCETH"), std::string("ETHBTC")));
+        REQUIRE(a != b);
+        REQUIRE(hash(std::make_pair(7, 7)) != 0);
+        REQUIRE(hash(std::make_tuple(1, 2, 3)) != hash(std::make_tuple(3, 2, 1)));
+    }
+    SECTION("Caches of pair keys keep working with stored hashes") {
+        Cache<std::pair<std::string, std::string>, int, cache_key_hash_function> cache(3);
+        cache.insert(std::make_pair("ETHBTC", "BTCETH"), 1);
+        cache.insert(std::make_pair("BTCETH", "ETHBTC"), 2);
+        cache.insert(std::make_pair("ETHBTC", "ETHBTC"), 3);
+        cache.insert(std::make_pair("ETHBTC", "BTCETH"), 4);
+        cache.insert(std::make_pair("BTCUSD", "2019-01-05"), 5);
+        REQUIRE(cache.size() == 3);
+        REQUIRE(cache.find(std::make_pair("ETHBTC", "BTCETH")).first == 1);
+        REQUIRE(cache.find(std::make_pair("BTCETH", "ETHBTC")).second == false);
+        REQUIRE(cache.find(std::make_pair("BTCUSD", "2019-01-05")).first == 5);
+        auto key = std::make_pair(std::string("ETHBTC"), std::string("ETHBTC"));
+        REQUIRE(cache.find(decltype(cache)::hash_key(key)).first == 3);
+    }
+}
+
+TEST_CASE("Key codec tests") {
+    using key_t = std::pair<std::string, std::string>;
+    SECTION("Symbol/date keys round-trip through a single integer") {
+        for (auto& key : {key_t("BTCUSD", "2019-01-05"), key_t("A", "1970-01-01"), key_t("BRK.B", "2000-02-29"),
+                          key_t("ETH-EUR", "2099-12-31"), key_t("", "2024-03-01")}) {
+            REQUIRE(symbol_date_codec::decode(symbol_date_codec::encode(key)) == key);
+        }
+        REQUIRE(symbol_date_codec::encode(key_t("BTCUSD", "2019-01-05")) !=
+                symbol_date_codec::encode(key_t("BTCUSD", "2019-01-06")));
+        REQUIRE(symbol_date_codec::encode(key_t("BTCUSD", "2019-01-05")) <
+                symbol_date_codec::encode(key_t("BTCUSD", "2019-02-01")));
+        REQUIRE(symbol_date_codec::encode(key_t("AB", "2019-01-05")) !=
+                symbol_date_codec::encode(key_t("BA", "2019-01-05")));
+    }
+    SECTION("Keys that do not fit are rejected") {
+        REQUIRE_THROWS_AS(symbol_date_codec::encode(key_t("BTCUSDTX", "2019-01-05")), const std::invalid_argument&);
+        REQUIRE_THROWS_AS(symbol_date_codec::encode(key_t("btcusd", "2019-01-05")), const std::invalid_argument&);
+        REQUIRE_THROWS_AS(symbol_date_codec::encode(key_t("BTCUSD", "2019-02-29")), const std::invalid_argument&);
+        REQUIRE_THROWS_AS(symbol_date_codec::encode(key_t("BTCUSD", "2019-1-05")), const std::invalid_argument&);
+        REQUIRE_THROWS_AS(symbol_date_codec::encode(key_t("BTCUSD", "1969-12-31")), const std::invalid_argument&);
+    }
+    SECTION("An encoded cache stores, finds and evicts packed keys") {
+        EncodedCache<key_t, int, symbol_date_codec, fixed_width_hash> cache(3);
+        cache.insert(key_t("BTCUSD", "2019-01-01"), 1);
+        cache.insert(key_t("BTCUSD", "2019-01-02"), 2);
+        cache.insert(key_t("ETHUSD", "2019-01-01"), 3);
+        cache.insert(key_t("BTCUSD", "2019-01-01"), 1);
+        cache.insert(key_t("ETHUSD", "2019-01-02"), 4);
+        REQUIRE(cache.size() == 3);
+        REQUIRE(cache.find(key_t("BTCUSD", "2019-01-01")).first == 1);
+        REQUIRE(cache.find(key_t("BTCUSD", "2019-01-02")).second == false);
+        REQUIRE(cache.find(key_t("ETHUSD", "2019-01-02")).first == 4);
+        REQUIRE_THROWS_AS(cache.find(key_t("BTCUSD", "2019-13-01")), const std::invalid_argument&);
+
+        key_t keys[] = {key_t("ETHUSD", "2019-01-01"), key_t("XRPUSD", "2019-01-01"), key_t("ETHUSD", "2019-01-02")};
+        int values[3] = {};
+        uint64_t found = 0;
+        cache.multi_find(keys, 3, values, &found);
+        REQUIRE(found == 0b101);
+        REQUIRE(values[0] == 3);
+        REQUIRE(values[2] == 4);
+    }
+    SECTION("Loaders and printing see the decoded keys") {
+        EncodedCache<key_t, std::string, symbol_date_codec, fixed_width_hash> cache(10);
+        auto loaded = cache.get_or_load(key_t("BTCUSD", "2019-01-05"), [](const key_t& key) {
+            return key.first + "@" + key.second;
+        });
+        REQUIRE(loaded == "BTCUSD@2019-01-05");
+        REQUIRE(cache.find(key_t("BTCUSD", "2019-01-05")).first == "BTCUSD@2019-01-05");
+        std::vector<key_t> printed;
+        cache.print([&printed](key_t key) { printed.push_back(key); }, [](std::string) {});
+        REQUIRE(printed.size() == 1);
+        REQUIRE(printed[0] == key_t("BTCUSD", "2019-01-05"));
+    }
+}
+
+TEST_CASE("Key interning tests") {
+    using key_t = std::pair<std::string, std::string>;
+    struct interning_test_tag {};
+    using codec_t = interned_pair_codec<interning_test_tag>;
+    using cache_t = EncodedCache<key_t, int, codec_t, fixed_width_hash>;
+    auto& pool = codec_t::pool();
+    REQUIRE(pool.size() == 0);
+
+    SECTION("Shared components are stored once and released with the last key") {
+        {
+            cache_t a(100);
+            cache_t b(100);
+            for (int day = 1; day <= 9; day++) {
+                auto date = "2019-01-0" + std::to_string(day);
+                a.insert(key_t("BTCUSD", date), day);
+                b.insert(key_t("ETHUSD", date), day);
+            }
+            a.insert(key_t("BTCUSD", "2019-01-01"), 1);
+            REQUIRE(pool.size() == 11);
+            REQUIRE(a.find(key_t("BTCUSD", "2019-01-05")).first == 5);
+            REQUIRE(b.find(key_t("ETHUSD", "2019-01-05")).first == 5);
+            REQUIRE(a.find(key_t("ETHUSD", "2019-01-05")).second == false);
+
+            // lookups of unknown strings do not intern them
+            REQUIRE(a.find(key_t("XRPUSD", "2019-01-05")).second == false);
+            REQUIRE(b.find(key_t("ETHUSD", "2020-01-01")).second == false);
+            REQUIRE(pool.size() == 11);
+        }
+        REQUIRE(pool.size() == 0);
+    }
+    SECTION("Evicted keys release their components and their ids are reused") {
+        cache_t cache(2);
+        cache.insert(key_t("BTCUSD", "2019-01-01"), 1);
+        cache.insert(key_t("BTCUSD", "2019-01-02"), 2);
+        cache.insert(key_t("ETHUSD", "2019-01-03"), 3);
+        REQUIRE(pool.size() == 4);
+        cache.insert(key_t("XRPUSD", "2019-01-04"), 4);
+        REQUIRE(pool.size() == 4);
+        REQUIRE(cache.find(key_t("BTCUSD", "2019-01-01")).second == false);
+        REQUIRE(cache.find(key_t("BTCUSD", "2019-01-02")).second == false);
+        REQUIRE(cache.find(key_t("ETHUSD", "2019-01-03")).first == 3);
+        REQUIRE(cache.find(key_t("XRPUSD", "2019-01-04")).first == 4);
+        std::vector<key_t> printed;
+        cache.print([&printed](key_t key) { printed.push_back(key); }, [](int) {});
+        std::sort(printed.begin(), printed.end());
+        REQUIRE(printed == std::vector<key_t>({key_t("ETHUSD", "2019-01-03"), key_t("XRPUSD", "2019-01-04")}));
+    }
+    SECTION("Loads hold their keys until they complete") {
+        {
+            cache_t cache(10);
+            REQUIRE(cache.get_or_load(key_t("BTCUSD", "2019-01-05"), [&pool](const key_t& key) {
+                REQUIRE(pool.size() == 2);
+                return static_cast<int>(key.second.size());
+            }) == 10);
+            cache.set_loader([](const key_t&) -> int { throw std::runtime_error("unavailable"); });
+            REQUIRE_THROWS_AS(cache.get_async(key_t("ETHUSD", "2019-01-05")).get(), const std::runtime_error&);
+            REQUIRE(pool.size() == 2);
+        }
+        REQUIRE(pool.size() == 0);
+    }
+    SECTION("Concurrent misses of new keys share one load") {
+        /// \brief Holds the cache's mutex in the first miss, until the second caller waits for it
+        struct stalling_policy_t : lru_policy_t<uint64_t>
+        {
+            void on_miss(const uint64_t&) override
+            {
+                if (!stalled.exchange(true)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+            }
+
+            std::atomic<bool> stalled{false};
+        };
+        {
+            cache_t cache(100);
+            cache.set_eviction_policy(std::unique_ptr<eviction_policy_t<uint64_t>>(new stalling_policy_t()));
+            std::atomic<int> loads(0);
+            auto load = [&cache, &loads]() {
+                return cache.get_or_load(key_t("SOLUSD", "2019-02-01"), [&loads](const key_t&) {
+                    loads++;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    return 1;
+                });
+            };
+            auto first = std::async(std::launch::async, load);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            auto second = std::async(std::launch::async, load);
+            REQUIRE(first.get() == 1);
+            REQUIRE(second.get() == 1);
+            REQUIRE(loads == 1);
+            REQUIRE(pool.size() == 2);
+        }
+        REQUIRE(pool.size() == 0);
+    }
+}